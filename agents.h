@@ -0,0 +1,233 @@
+#ifndef AGENTS_H
+#define AGENTS_H
+
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+#include "gameboard.h"
+#include "solver.h"
+
+// A player that picks the moves of a game
+// Agents keep state between moves of one game, so each thread needs its own instances
+class Agent
+{
+public:
+    virtual ~Agent()
+    {
+    }
+
+    // Returns the name the agent is chosen by
+    virtual const char * name() = 0;
+
+    // Called with the dealt board before the first move of each game
+    virtual void newGame(GameBoard * board, unsigned int seed) = 0;
+
+    // Sets move to the next move to play on board, returns false to resign
+    virtual bool choose(GameBoard * board, Move & move) = 0;
+};
+
+static const int STALL_MOVES = 100; // Moves without progress before greedy and random agents resign
+
+// Plays the first of the solver's candidate moves that leads to a position not yet
+// reached in the game, and resigns when every move leads back to one or after STALL_MOVES
+// moves without a new high in the foundation, a face down card turned over or a card
+// played from the discard
+class GreedyAgent : public Agent
+{
+protected:
+    Solver movegen = Solver(0);                  // Only used for candidateMoves
+    std::vector<Move> moves;                     // Candidate moves of the current position
+    std::unordered_set<unsigned long long> seen; // Hashes of the positions reached this game
+    int bestcards = 0;                           // Most cards the foundation has held
+    int fewesthidden = 0;                        // Fewest cards face down or in the discard
+    int stalled = 0;                             // Moves since either of the above improved
+
+    // Resets the per game state
+    void clear()
+    {
+        seen.clear();
+        bestcards = 0;
+        fewesthidden = KlondikeRules::CARDS;
+        stalled = 0;
+    }
+
+    // Updates the progress made on board, returns false once the game has stalled
+    bool progressing(GameBoard * board)
+    {
+        int hidden = 0;
+        for(int x = 0; x < KlondikeRules::DISCARD_CARDS; x++)
+        {
+            hidden += !board->cardAt(KlondikeRules::DISCARD, x)->getPH();
+        }
+        for(int y = KlondikeRules::FIRST_TABLEAU; y < KlondikeRules::PILES; y++)
+        {
+            for(int x = 0; x < KlondikeRules::capacity(y) && !board->cardAt(y, x)->getPH(); x++)
+            {
+                hidden += !board->cardAt(y, x)->getRevealed();
+            }
+        }
+        int cards = 0;
+        for(int s = 0; s < KlondikeRules::SUITS; s++)
+        {
+            cards += board->foundationRank(suits[s]);
+        }
+        stalled++;
+        if(cards > bestcards || hidden < fewesthidden)
+        {
+            bestcards = cards > bestcards ? cards : bestcards;
+            fewesthidden = hidden < fewesthidden ? hidden : fewesthidden;
+            stalled = 0;
+        }
+        return stalled <= STALL_MOVES;
+    }
+
+    // Sets move to the first of moves that is legal on board and leads to a new position
+    bool firstNew(GameBoard * board, Move & move)
+    {
+        for(size_t i = 0; i < moves.size(); i++)
+        {
+            GameBoard * child = board->clone();
+            bool found = child->applyMove(moves[i]) && seen.count(child->hashState()) == 0;
+            child->deallocate();
+            delete child;
+            if(found)
+            {
+                move = moves[i];
+                return true;
+            }
+        }
+        return false;
+    }
+public:
+    const char * name()
+    {
+        return "greedy";
+    }
+
+    void newGame(GameBoard * board, unsigned int seed)
+    {
+        clear();
+    }
+
+    bool choose(GameBoard * board, Move & move)
+    {
+        if(!progressing(board))
+        {
+            return false;
+        }
+        seen.insert(board->hashState());
+        movegen.candidateMoves(board, moves);
+        return firstNew(board, move);
+    }
+};
+
+// Plays a random candidate move that leads to a new position, seeded by the deal so games
+// are repeatable
+class RandomAgent : public GreedyAgent
+{
+private:
+    unsigned int randstate = 0;
+public:
+    const char * name()
+    {
+        return "random";
+    }
+
+    void newGame(GameBoard * board, unsigned int seed)
+    {
+        clear();
+        randstate = seed;
+    }
+
+    bool choose(GameBoard * board, Move & move)
+    {
+        if(!progressing(board))
+        {
+            return false;
+        }
+        seen.insert(board->hashState());
+        movegen.candidateMoves(board, moves);
+        for(size_t i = moves.size(); i > 1; i--)
+        {
+            size_t j = rand_r(&randstate) % i;
+            Move swap = moves[i - 1];
+            moves[i - 1] = moves[j];
+            moves[j] = swap;
+        }
+        return firstNew(board, move);
+    }
+};
+
+// Solves the deal on the first move and plays the solution, falling back to greedy play
+// if the search fails
+// The solver sees the face down cards, so this is an upper bound for fair agents rather
+// than a fair agent itself, and its first decision shows the cost of a full search
+class SolverAgent : public GreedyAgent
+{
+private:
+    Solver solver;
+    Tablebase * tablebase;
+    std::vector<Move> plan; // Solution being played
+    size_t next = 0;        // Index of the next move of plan
+    bool searched = false;  // true once the deal has been searched
+public:
+    SolverAgent(long nodelimit, Tablebase * tb) : solver(nodelimit)
+    {
+        tablebase = tb;
+    }
+
+    const char * name()
+    {
+        return "solver";
+    }
+
+    void newGame(GameBoard * board, unsigned int seed)
+    {
+        clear();
+        plan.clear();
+        next = 0;
+        searched = false;
+    }
+
+    bool choose(GameBoard * board, Move & move)
+    {
+        if(!searched)
+        {
+            searched = true;
+            solver.reset();
+            solver.setTablebase(tablebase);
+            if(solver.search(board))
+            {
+                plan = solver.getPath();
+            }
+        }
+        if(next < plan.size())
+        {
+            move = plan[next++];
+            return true;
+        }
+        return GreedyAgent::choose(board, move);
+    }
+};
+
+// Returns a new agent of the given name, or nullptr if there is no such agent
+// nodelimit and tablebase are used by agents that search
+inline Agent * makeAgent(const char * name, long nodelimit, Tablebase * tablebase)
+{
+    if(strcmp(name, "greedy") == 0)
+    {
+        return new GreedyAgent();
+    }
+    if(strcmp(name, "random") == 0)
+    {
+        return new RandomAgent();
+    }
+    if(strcmp(name, "solver") == 0)
+    {
+        return new SolverAgent(nodelimit, tablebase);
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+// Replaces the file at path with data, returns true if successful
+// The data is written to path.tmp, synced to disk and renamed over path, so readers and a
+// crash only ever see the old file or the whole new one
+inline bool writeFileAtomically(const char * path, const std::vector<uint8_t> & data)
+{
+    std::vector<char> tmppath(strlen(path) + 5);
+    snprintf(tmppath.data(), tmppath.size(), "%s.tmp", path);
+    FILE * file = fopen(tmppath.data(), "wb");
+    if(file == nullptr)
+    {
+        return false;
+    }
+    bool ok = data.empty() || fwrite(data.data(), data.size(), 1, file) == 1;
+    ok = fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok;
+    ok = fclose(file) == 0 && ok;
+    if(!ok || rename(tmppath.data(), path) != 0)
+    {
+        remove(tmppath.data());
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,124 @@
+// Times the engine, the solver and the renderer on a fixed workload
+// Usage: bench [deals] [first seed] [node limit]
+// Build: clang++ -std=gnu++11 -O2 -pthread -lncurses bench.cpp -o bench
+//
+// This is the workload the profile-guided build is trained on. Random and greedy agents
+// play every deal, the solver searches every deal, and the greedy games are laid out and
+// recorded frame by frame, as replayexport does. Everything runs on one thread so builds
+// can be compared, and one line is printed for each phase with its rate and time
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "agents.h"
+#include "gameboard.h"
+#include "solver.h"
+
+static const int MAX_MOVES = 10000; // Moves before a game is stopped, as in tourney
+
+typedef BasicRecording<GameBoard::Screen::HEIGHT, GameBoard::Screen::WIDTH> Recording;
+
+// Returns the seconds since start
+double since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Plays a deal with an agent, appends its moves to played and returns how many there were
+int play(Agent * agent, int drawtype, unsigned int seed, std::vector<Move> & played)
+{
+    GameBoard * board = new GameBoard(drawtype, seed);
+    agent->newGame(board, seed);
+    int moves = 0;
+    Move move;
+    while(!board->isWon() && moves < MAX_MOVES && agent->choose(board, move) && board->applyMove(move))
+    {
+        played.push_back(move);
+        moves++;
+    }
+    board->deallocate();
+    delete board;
+    return moves;
+}
+
+// Prints a phase's rate and time, in the columns the benchmark target compares
+void report(const char * phase, double count, const char * unit, double seconds)
+{
+    printf("%-8s %14.0f %-10s %8.3f s\n", phase, seconds > 0 ? count / seconds : 0, unit, seconds);
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned int deals = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200;
+    unsigned int first = argc > 2 ? strtoul(argv[2], nullptr, 10) : 0;
+    long nodelimit = argc > 3 ? atol(argv[3]) : 2000;
+    if(deals == 0 || nodelimit <= 0)
+    {
+        printf("Usage: %s [deals] [first seed] [node limit]\n", argv[0]);
+        return 1;
+    }
+
+    // Self-play, the greedy games are kept for rendering
+    std::vector<std::vector<Move> > games(deals);
+    Agent * agents[2] = {new RandomAgent(), new GreedyAgent()};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double moves = 0;
+    for(unsigned int i = 0; i < deals; i++)
+    {
+        int drawtype = (first + i) % 2 == 0 ? 1 : 3;
+        std::vector<Move> discarded;
+        moves += play(agents[0], drawtype, first + i, discarded);
+        moves += play(agents[1], drawtype, first + i, games[i]);
+    }
+    double playtime = since(start);
+    delete agents[0];
+    delete agents[1];
+
+    // Search
+    Solver solver(nodelimit);
+    start = std::chrono::steady_clock::now();
+    double nodes = 0;
+    for(unsigned int i = 0; i < deals; i++)
+    {
+        GameBoard * board = new GameBoard((first + i) % 2 == 0 ? 1 : 3, first + i);
+        solver.reset();
+        solver.search(board);
+        nodes += solver.getNodes();
+        board->deallocate();
+        delete board;
+    }
+    double solvetime = since(start);
+
+    // Rendering
+    start = std::chrono::steady_clock::now();
+    double frames = 0;
+    size_t bytes = 0;
+    for(unsigned int i = 0; i < deals; i++)
+    {
+        GameBoard * board = new GameBoard((first + i) % 2 == 0 ? 1 : 3, first + i);
+        board->boardRefresh();
+        GameBoard::Screen screen;
+        Recording recording(nullptr);
+        for(size_t m = 0; m <= games[i].size(); m++)
+        {
+            board->layout(screen, m < games[i].size() ? games[i][m].boardy : -1, m < games[i].size() ? games[i][m].boardx : -1, false, -1);
+            recording.frame(screen, m * 0.1);
+            if(m < games[i].size())
+            {
+                board->applyMove(games[i][m]);
+            }
+        }
+        frames += games[i].size() + 1;
+        bytes += recording.text().size();
+        board->deallocate();
+        delete board;
+    }
+    double rendertime = since(start);
+
+    printf("%u deals from seed %u, node limit %ld, %zu bytes recorded\n", deals, first, nodelimit, bytes);
+    report("play", moves, "moves/s", playtime);
+    report("solve", nodes, "nodes/s", solvetime);
+    report("render", frames, "frames/s", rendertime);
+    printf("%-8s %14s %-10s %8.3f s\n", "total", "", "", playtime + solvetime + rendertime);
+    return 0;
+}
@@ -11,9 +11,9 @@ while(cont):
         contintest = "y"
         start = False
     if contintest in ("Y", "y", ""):
-        os.system("clear\nrm Solitaire\nclang++ -std=gnu++11 -lncurses main.cpp -o Solitaire\n")
+        os.system("clear\nmake release\n")
         os.system("rm endwin\nclang++ -std=gnu++11 -lncurses endwin.cpp -o endwin")
-        if os.system("./Solitaire") != 0:
+        if os.system("./build/release/solitaire") != 0:
             os.system("./endwin")
             print("An error has occured. Most likely a segfault or compilation error.")
             exit()
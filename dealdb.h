@@ -0,0 +1,192 @@
+#ifndef DEALDB_H
+#define DEALDB_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "atomicfile.h"
+
+static const char DEALDB_MAGIC[8] = {'S', 'O', 'L', 'D', 'E', 'A', 'L', 'S'};
+static const uint32_t DEALDB_VERSION = 1;
+
+// Flags stored in DealRecord::flags
+enum DealFlag
+{
+    solved1 = 1,   // The draw 1 search finished, so winnable1 is certain
+    winnable1 = 2, // The deal can be won in draw 1
+    solved3 = 4,   // The draw 3 search finished, so winnable3 is certain
+    winnable3 = 8  // The deal can be won in draw 3
+};
+
+// Header at the start of a deal database file
+typedef struct
+{
+    char magic[8];        // Always DEALDB_MAGIC
+    uint32_t version;     // Always DEALDB_VERSION
+    uint32_t count;       // Number of records, one for each seed from 0 to count - 1
+    uint32_t winnable[2]; // Number of winnable seeds for draw 1 and draw 3
+} DealDBHeader;
+
+// Solver result for one seed, the record for seed s is at index s
+typedef struct
+{
+    uint8_t flags;         // A combination of DealFlag values
+    uint8_t difficulty[2]; // 0 to 9 for draw 1 and draw 3, the log10 of the nodes searched
+    uint8_t pad;
+    uint16_t moves[2];     // Moves in the solution found for draw 1 and draw 3, 0 if none
+} DealRecord;
+
+// Read-only, memory-mapped deal database
+// The file is a DealDBHeader, then count DealRecords, then the winnable draw 1 seeds
+// followed by the winnable draw 3 seeds as uint32_t
+class DealDB
+{
+private:
+    void * map = nullptr;                  // Mapped file
+    size_t maplen = 0;                     // Length of the mapped file
+    const DealDBHeader * header = nullptr; // Header of the mapped file
+    const DealRecord * records = nullptr;  // Records indexed by seed
+    const uint32_t * winnable[2];          // Winnable seeds for draw 1 and draw 3
+public:
+    DealDB()
+    {
+        winnable[0] = nullptr;
+        winnable[1] = nullptr;
+    }
+
+    ~DealDB()
+    {
+        close();
+    }
+
+    // Maps a deal database file and returns true if it is valid, false if not
+    bool open(const char * path)
+    {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(DealDBHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        maplen = st.st_size;
+        map = mmap(nullptr, maplen, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(map == MAP_FAILED)
+        {
+            map = nullptr;
+            return false;
+        }
+
+        header = (const DealDBHeader *) map;
+        size_t expected = sizeof(DealDBHeader) + header->count * sizeof(DealRecord) +
+            (header->winnable[0] + header->winnable[1]) * sizeof(uint32_t);
+        if
+        (
+            memcmp(header->magic, DEALDB_MAGIC, 8) != 0 ||
+            header->version != DEALDB_VERSION ||
+            expected != maplen
+        )
+        {
+            close();
+            return false;
+        }
+        records = (const DealRecord *) (header + 1);
+        winnable[0] = (const uint32_t *) (records + header->count);
+        winnable[1] = winnable[0] + header->winnable[0];
+        return true;
+    }
+
+    // Unmaps the file if one is open
+    void close()
+    {
+        if(map != nullptr)
+        {
+            munmap(map, maplen);
+        }
+        map = nullptr;
+        header = nullptr;
+        records = nullptr;
+        winnable[0] = nullptr;
+        winnable[1] = nullptr;
+    }
+
+    // Returns the number of records in the database
+    uint32_t count()
+    {
+        return header == nullptr ? 0 : header->count;
+    }
+
+    // Returns the record for a seed, or nullptr if the seed is not in the database
+    const DealRecord * lookup(uint32_t seed)
+    {
+        if(header == nullptr || seed >= header->count)
+        {
+            return nullptr;
+        }
+        return &records[seed];
+    }
+
+    // Returns the number of winnable seeds for a draw type (1 or 3)
+    uint32_t winnableCount(int drawtype)
+    {
+        return header == nullptr ? 0 : header->winnable[drawtype == 1 ? 0 : 1];
+    }
+
+    // Returns a random winnable seed for a draw type, winnableCount must not be 0
+    uint32_t randomWinnable(int drawtype, unsigned int * randstate)
+    {
+        int i = drawtype == 1 ? 0 : 1;
+        return winnable[i][rand_r(randstate) % header->winnable[i]];
+    }
+
+    // Writes records for seeds 0 to records.size() - 1 to a new database file
+    static bool write(const char * path, const std::vector<DealRecord> & records)
+    {
+        DealDBHeader header;
+        std::vector<uint32_t> winnable[2];
+        memcpy(header.magic, DEALDB_MAGIC, 8);
+        header.version = DEALDB_VERSION;
+        header.count = records.size();
+        for(uint32_t seed = 0; seed < records.size(); seed++)
+        {
+            if(records[seed].flags & DealFlag::winnable1)
+            {
+                winnable[0].push_back(seed);
+            }
+            if(records[seed].flags & DealFlag::winnable3)
+            {
+                winnable[1].push_back(seed);
+            }
+        }
+        header.winnable[0] = winnable[0].size();
+        header.winnable[1] = winnable[1].size();
+
+        std::vector<uint8_t> data(sizeof(header) + records.size() * sizeof(DealRecord) +
+            (winnable[0].size() + winnable[1].size()) * sizeof(uint32_t));
+        uint8_t * out = data.data();
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        memcpy(out, records.data(), records.size() * sizeof(DealRecord));
+        out += records.size() * sizeof(DealRecord);
+        for(int i = 0; i < 2; i++)
+        {
+            memcpy(out, winnable[i].data(), winnable[i].size() * sizeof(uint32_t));
+            out += winnable[i].size() * sizeof(uint32_t);
+        }
+        return writeFileAtomically(path, data);
+    }
+};
+
+#endif
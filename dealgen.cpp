@@ -0,0 +1,125 @@
+// Builds the deal database used for winnable deals only games
+// Usage: dealgen <count> [file] [node limit] [tablebase]
+// Build: clang++ -std=gnu++11 -pthread -lncurses dealgen.cpp -o dealgen
+#define SOLI_METRICS_MAIN // Count allocations in this program
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "dealdb.h"
+#include "gameboard.h"
+#include "metrics.h"
+#include "solver.h"
+#include "trace.h"
+
+// Solves one seed for both draw types and fills its record
+void solveSeed(unsigned int seed, long nodelimit, Tablebase * tablebase, DealRecord * record)
+{
+    static const uint8_t solvedflags[2] = {DealFlag::solved1, DealFlag::solved3};
+    static const uint8_t winnableflags[2] = {DealFlag::winnable1, DealFlag::winnable3};
+    static const int drawtypes[2] = {1, 3};
+
+    TRACE_SPAN("solveSeed");
+    memset(record, 0, sizeof(DealRecord));
+    Solver * solver = new Solver(nodelimit);
+    solver->setTablebase(tablebase);
+    for(int i = 0; i < 2; i++)
+    {
+        GameBoard * board = new GameBoard(drawtypes[i], seed);
+        solver->reset();
+        bool won = solver->search(board);
+        if(won)
+        {
+            record->flags |= solvedflags[i] | winnableflags[i];
+            record->moves[i] = solver->getPath().size();
+        }
+        else if(solver->isComplete())
+        {
+            record->flags |= solvedflags[i];
+        }
+        record->difficulty[i] = (uint8_t) log10((double) solver->getNodes() + 1);
+        board->deallocate();
+        delete board;
+    }
+    delete solver;
+}
+
+int main(int argc, char ** argv)
+{
+    if(argc < 2)
+    {
+        printf("Usage: %s <count> [file] [node limit] [tablebase]\n", argv[0]);
+        return 1;
+    }
+    unsigned int count = strtoul(argv[1], nullptr, 10);
+    const char * path = argc > 2 ? argv[2] : "deals.db";
+    long nodelimit = argc > 3 ? strtol(argv[3], nullptr, 10) : 200000;
+    Tablebase * tablebase = nullptr;
+    if(argc > 4)
+    {
+        tablebase = new Tablebase();
+        if(!tablebase->open(argv[4]))
+        {
+            printf("Could not open %s\n", argv[4]);
+            return 1;
+        }
+    }
+
+    metricsPublish("dealgen");
+
+    // Each thread takes the next unsolved seed until all are done
+    std::vector<DealRecord> records(count);
+    std::atomic<unsigned int> next(0);
+    std::atomic<unsigned int> done(0);
+    unsigned int threadcount = std::thread::hardware_concurrency();
+    if(threadcount == 0)
+    {
+        threadcount = 1;
+    }
+    std::vector<std::thread> threads;
+    for(unsigned int t = 0; t < threadcount; t++)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            for(unsigned int seed = next++; seed < count; seed = next++)
+            {
+                solveSeed(seed, nodelimit, tablebase, &records[seed]);
+                unsigned int finished = ++done;
+                if(finished % 100 == 0)
+                {
+                    fprintf(stderr, "\r%u/%u", finished, count);
+                }
+            }
+            metricsFlush();
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+    fprintf(stderr, "\r%u/%u\n", count, count);
+
+    unsigned int winnable[2] = {0, 0};
+    unsigned int solved[2] = {0, 0};
+    for(unsigned int seed = 0; seed < count; seed++)
+    {
+        winnable[0] += (records[seed].flags & DealFlag::winnable1) != 0;
+        winnable[1] += (records[seed].flags & DealFlag::winnable3) != 0;
+        solved[0] += (records[seed].flags & DealFlag::solved1) != 0;
+        solved[1] += (records[seed].flags & DealFlag::solved3) != 0;
+    }
+    printf("Draw 1: %u winnable, %u unwinnable, %u unknown\n", winnable[0], solved[0] - winnable[0], count - solved[0]);
+    printf("Draw 3: %u winnable, %u unwinnable, %u unknown\n", winnable[1], solved[1] - winnable[1], count - solved[1]);
+
+    delete tablebase;
+    TRACE_WRITE("dealgen.trace.json");
+    metricsUnpublish();
+    if(!DealDB::write(path, records))
+    {
+        printf("Could not write %s\n", path);
+        return 1;
+    }
+    return 0;
+}
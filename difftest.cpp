@@ -0,0 +1,357 @@
+// Checks that GameBoard plays exactly like the reference model in reference.h
+// Usage: difftest <deals> [steps per deal] [first seed]
+// Build: clang++ -std=gnu++11 -O2 -pthread -lncurses difftest.cpp -o difftest
+//
+// Each deal is played by both engines with the same seeded stream of steps: draws, moves
+// the solver suggests, which are mostly legal, and moves to random coordinates, which are
+// mostly not. After every step the results and the full states must match. The lowest
+// seed that diverges is replayed with as few steps as still diverge and printed, and the
+// exit status is 1, so the test can gate a release
+//
+// The same deals are then played on the six pile variant in SixPileRules, which has no
+// reference model, so only its states are checked. Every member of the engine and solver
+// is compiled for it, so a size taken from KlondikeRules instead of the policy shows here
+#define SOLI_METRICS_MAIN // Count allocations in this program
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "gameboard.h"
+#include "history.h"
+#include "metrics.h"
+#include "reference.h"
+#include "solver.h"
+
+template class BasicGameBoard<SixPileRules>;
+template class BasicSolver<SixPileRules>;
+template class BasicHistory<SixPileRules>;
+
+typedef BasicGameBoard<SixPileRules> SixPileBoard;
+
+// Returns the draw type a seed is played with, so both are covered
+int drawTypeOf(unsigned int seed)
+{
+    return seed % 2 == 0 ? 1 : 3;
+}
+
+// Sets a random move that reads only inside the board, as the front end's cursor does
+// Tableau moves stay below the last slot since moveCard looks at the slot after boardx
+void randomMove(Move & move, unsigned int * randstate)
+{
+    move.boardy = rand_r(randstate) % 12;
+    int width = move.boardy == 0 ? pilelens[0] : move.boardy < 5 ? pilelens[move.boardy] : pilelens[move.boardy] - 1;
+    move.boardx = rand_r(randstate) % width;
+    move.pileindex = rand_r(randstate) % 12;
+}
+
+// Returns true if a tableau to tableau step could put a card past the end of the
+// destination, which makes both engines write outside the board
+// Piles only get that full after the moves that lose or copy cards, such as moving a
+// tableau card to the foundation from above the last card, which can also leave gaps
+bool overflows(GameBoard * board, const Move & step)
+{
+    if(step.boardy < 5 || step.pileindex < 5 || step.boardy == step.pileindex)
+    {
+        return false;
+    }
+    int top = -1;
+    int empty = 0;
+    for(int x = 0; x < pilelens[step.pileindex]; x++)
+    {
+        if(board->cardAt(step.pileindex, x)->getPH())
+        {
+            empty++;
+        }
+        else
+        {
+            top = x;
+        }
+    }
+    int moving = 0;
+    while(step.boardx + moving < pilelens[step.boardy] && !board->cardAt(step.boardy, step.boardx + moving)->getPH())
+    {
+        moving++;
+    }
+
+    // A single card goes after the top card, a run goes into the first free slots
+    return moving == 1 ? top + 1 >= pilelens[step.pileindex] : moving > empty;
+}
+
+// Plays steps on a new deal with both engines, returns the index of the first step after
+// which they differ, or -1 if they never do
+// If what is not nullptr it is set to a description of the difference
+int replay(unsigned int seed, const std::vector<Move> & steps, char * what, size_t len)
+{
+    GameBoard * board = new GameBoard(drawTypeOf(seed), seed);
+    ReferenceBoard * reference = new ReferenceBoard(drawTypeOf(seed), seed);
+    unsigned char state[STATE_SIZE];
+    unsigned char expected[STATE_SIZE];
+    int diverged = -1;
+    for(size_t i = 0; i < steps.size() && diverged == -1; i++)
+    {
+        const Move & step = steps[i];
+        bool moved = board->applyMove(step);
+        bool expectmoved = true;
+        if(step.boardy == -1)
+        {
+            reference->draw();
+        }
+        else
+        {
+            expectmoved = reference->moveCard(step.boardy, step.boardx, step.pileindex);
+        }
+        reference->boardRefresh();
+
+        board->saveState(state);
+        reference->saveState(expected);
+        if(moved != expectmoved)
+        {
+            diverged = i;
+            if(what != nullptr)
+            {
+                snprintf(what, len, "GameBoard returned %s, the reference %s", moved ? "true" : "false", expectmoved ? "true" : "false");
+            }
+        }
+        else if(memcmp(state, expected, STATE_SIZE) != 0)
+        {
+            diverged = i;
+            int n = 0;
+            while(state[n] == expected[n])
+            {
+                n++;
+            }
+            if(what != nullptr)
+            {
+                snprintf(what, len, "state byte %d is 0x%02x, the reference has 0x%02x", n, state[n], expected[n]);
+            }
+        }
+    }
+    board->deallocate();
+    delete board;
+    reference->deallocate();
+    delete reference;
+    return diverged;
+}
+
+// Plays one deal with a stream of random steps, returns the index of the first diverging
+// step or -1, and fills steps with the stream up to it
+// Steps that overflow a pile are left out of the stream and counted in skipped
+int check(unsigned int seed, int count, std::vector<Move> & steps, unsigned long & skipped)
+{
+    unsigned int randstate = seed * 2654435761u + 1;
+    GameBoard * board = new GameBoard(drawTypeOf(seed), seed);
+    ReferenceBoard * reference = new ReferenceBoard(drawTypeOf(seed), seed);
+    Solver movegen(0);
+    std::vector<Move> candidates;
+    unsigned char state[STATE_SIZE];
+    unsigned char expected[STATE_SIZE];
+    int diverged = -1;
+    steps.clear();
+    for(int i = 0; i < count && diverged == -1; i++)
+    {
+        Move step;
+        int kind = rand_r(&randstate) % 100;
+        if(kind < 15)
+        {
+            step.boardy = -1;
+            step.boardx = 0;
+            step.pileindex = 0;
+        }
+        else if(kind < 60)
+        {
+            movegen.candidateMoves(board, candidates);
+            step = candidates[rand_r(&randstate) % candidates.size()];
+        }
+        else
+        {
+            randomMove(step, &randstate);
+        }
+        if(overflows(board, step))
+        {
+            skipped++;
+            continue;
+        }
+        steps.push_back(step);
+
+        bool moved = board->applyMove(step);
+        bool expectmoved = true;
+        if(step.boardy == -1)
+        {
+            reference->draw();
+        }
+        else
+        {
+            expectmoved = reference->moveCard(step.boardy, step.boardx, step.pileindex);
+        }
+        reference->boardRefresh();
+        board->saveState(state);
+        reference->saveState(expected);
+        if(moved != expectmoved || memcmp(state, expected, STATE_SIZE) != 0)
+        {
+            diverged = i;
+        }
+    }
+    board->deallocate();
+    delete board;
+    reference->deallocate();
+    delete reference;
+    return diverged;
+}
+
+// Plays a deal of the six pile variant with the moves the solver suggests, laying out the
+// board after each one, returns the index of the first step that leaves a state failing
+// validState, or -1 if none does
+// Random coordinates are left out, since they reach the moves that lose or copy cards
+int checkVariant(unsigned int seed, int count)
+{
+    unsigned int randstate = seed * 2654435761u + 1;
+    SixPileBoard * board = new SixPileBoard(drawTypeOf(seed), seed);
+    BasicSolver<SixPileRules> movegen(0);
+    std::vector<Move> candidates;
+    SixPileBoard::Screen screen;
+    unsigned char state[SixPileBoard::STATE_BYTES];
+    int invalid = -1;
+    board->boardRefresh();
+    for(int i = 0; i < count && invalid == -1; i++)
+    {
+        movegen.candidateMoves(board, candidates);
+        board->applyMove(candidates[rand_r(&randstate) % candidates.size()]);
+        board->layout(screen, SixPileRules::DISCARD, 0, false, 0);
+        board->saveState(state);
+        if(!SixPileBoard::validState(state))
+        {
+            invalid = i;
+        }
+    }
+    board->deallocate();
+    delete board;
+    return invalid;
+}
+
+// Removes steps from a diverging stream for as long as it still diverges, first in large
+// chunks and then one at a time
+void minimize(unsigned int seed, std::vector<Move> & steps)
+{
+    for(size_t chunk = steps.size() / 2; chunk >= 1; chunk /= 2)
+    {
+        for(size_t start = 0; start + chunk <= steps.size();)
+        {
+            std::vector<Move> shorter(steps.begin(), steps.begin() + start);
+            shorter.insert(shorter.end(), steps.begin() + start + chunk, steps.end());
+            int diverged = replay(seed, shorter, nullptr, 0);
+            if(diverged != -1)
+            {
+                shorter.resize(diverged + 1);
+                steps = shorter;
+            }
+            else
+            {
+                start += chunk;
+            }
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    if(argc < 2)
+    {
+        printf("Usage: %s <deals> [steps per deal] [first seed]\n", argv[0]);
+        return 1;
+    }
+    unsigned int count = strtoul(argv[1], nullptr, 10);
+    int steps = argc > 2 ? atoi(argv[2]) : 1000;
+    unsigned int first = argc > 3 ? strtoul(argv[3], nullptr, 10) : 0;
+    metricsPublish("difftest");
+
+    // Each thread takes the next deal, and deals after the lowest diverging one are skipped
+    std::atomic<unsigned int> next(0);
+    std::atomic<unsigned int> firstbad(UINT_MAX);
+    std::atomic<unsigned long> played(0);
+    std::atomic<unsigned long> overflowing(0);
+    unsigned int threadcount = std::thread::hardware_concurrency();
+    if(threadcount == 0)
+    {
+        threadcount = 1;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(unsigned int t = 0; t < threadcount; t++)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            std::vector<Move> stream;
+            unsigned long total = 0;
+            unsigned long skipped = 0;
+            for(unsigned int i = next++; i < count && i < firstbad; i = next++)
+            {
+                int diverged = check(first + i, steps, stream, skipped);
+                total += stream.size();
+                unsigned int bad = firstbad;
+                while(diverged != -1 && i < bad && !firstbad.compare_exchange_weak(bad, i));
+            }
+            played += total;
+            overflowing += skipped;
+            metricsFlush();
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%lu steps on %u threads, %.0f steps per second\n", (unsigned long) played, threadcount,
+        seconds > 0 ? played / seconds : 0);
+    printf("%lu steps left out because they overflow a tableau pile in both engines\n", (unsigned long) overflowing);
+
+    int status = 0;
+    if(firstbad == UINT_MAX)
+    {
+        printf("%u deals from seed %u, no divergence\n", count, first);
+    }
+    else
+    {
+        unsigned int seed = first + firstbad;
+        std::vector<Move> stream;
+        unsigned long skipped = 0;
+        int diverged = check(seed, steps, stream, skipped);
+        printf("Seed %u, draw %d diverges at step %d of the stream\n", seed, drawTypeOf(seed), diverged + 1);
+        minimize(seed, stream);
+        char what[128];
+        replay(seed, stream, what, sizeof(what));
+        printf("Minimized to %zu steps from the deal, after the last one %s:\n", stream.size(), what);
+        for(size_t i = 0; i < stream.size(); i++)
+        {
+            if(stream[i].boardy == -1)
+            {
+                printf("    draw()\n");
+            }
+            else
+            {
+                printf("    moveCard(%d, %d, %d)\n", stream[i].boardy, stream[i].boardx, stream[i].pileindex);
+            }
+        }
+        status = 1;
+    }
+
+    for(unsigned int i = 0; i < count; i++)
+    {
+        int invalid = checkVariant(first + i, steps);
+        if(invalid != -1)
+        {
+            printf("Six pile variant seed %u, draw %d leaves an invalid state at step %d\n", first + i, drawTypeOf(first + i), invalid + 1);
+            status = 1;
+            break;
+        }
+        if(i == count - 1)
+        {
+            printf("%u deals of the six pile variant from seed %u, every state valid\n", count, first);
+        }
+    }
+    metricsUnpublish();
+    return status;
+}
@@ -0,0 +1,319 @@
+#ifndef ESTIMATOR_H
+#define ESTIMATOR_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "gameboard.h"
+#include "history.h"
+#include "metrics.h"
+#include "solver.h"
+#include "stats.h"
+#include "trace.h"
+
+// Result of the samples taken so far after one move from the current position
+typedef struct
+{
+    Move move;      // The move
+    int samples;    // Number of deals sampled after the move
+    int wins;       // Number of those deals the solver won
+    double winrate; // wins / samples
+    double low;     // Lower end of the 95% Wilson interval for winrate
+    double high;    // Upper end of the 95% Wilson interval for winrate
+} MoveEstimate;
+
+// Result of the samples taken so far for the current position
+typedef struct
+{
+    int samples;                     // Number of deals sampled
+    int wins;                        // Number of sampled deals the solver won
+    double winrate;                  // wins / samples
+    double low;                      // Lower end of the 95% Wilson interval for winrate
+    double high;                     // Upper end of the 95% Wilson interval for winrate
+    std::vector<MoveEstimate> moves; // Every move the board accepts, in candidateMoves order
+    int best;                        // Index in moves of the highest win rate, -1 until sampled
+} Estimate;
+
+// Writes a short description of a move such as "P3 -> F1" or "Draw" into buf
+inline void describeMove(Move move, char * buf, size_t len)
+{
+    if(move.boardy == -1)
+    {
+        snprintf(buf, len, "Draw");
+    }
+    else
+    {
+        snprintf(buf, len, "%s -> %s", KlondikeRules::name(move.boardy), KlondikeRules::name(move.pileindex));
+    }
+}
+
+// Estimates the chance of winning from a position where the player cannot see the face
+// down tableau cards or the cards not yet drawn from the stock
+// Each sample deals the unseen cards into the unseen positions at random and solves the
+// result as a perfect information game, searches that reach the node limit count as losses
+// Every move from the position is sampled on its own as well, by making the move on the
+// sampled deal before solving it, so each move gets a win rate of its own to compare
+// Worker threads sample in the background, taking whichever of the position and its
+// moves has the fewest samples, and update() restarts them on a new position
+class Estimator
+{
+private:
+    long nodelimit;                    // Node limit of each solve
+    int maxsamples;                    // Samples of the position and of each move before the workers wait
+    int drawtype;                      // Draw type of the game
+    bool seen[KlondikeRules::CARDS];   // Cards the player has seen, indexed by Card::getID
+    unsigned char root[STATE_SIZE];    // State of the current position
+    int generation = 0;                // Increases every time the position changes
+    std::vector<Move> moves;           // Moves the board accepts from the current position
+    std::vector<int> taken;            // Samples started of the position, then of each move
+    std::vector<int> samples;          // Samples finished of the position, then of each move
+    std::vector<int> wins;             // Won samples of the position, then of each move
+    bool haveroot = false;             // false until update is called
+    bool stopping = false;             // true when the workers should exit
+    std::mutex lock;                   // Guards every member above
+    std::condition_variable changed;   // Signals a new position or stopping
+    std::vector<std::thread> workers;  // Sampling threads
+    Tablebase * tablebase = nullptr;   // Late game positions for the solvers, if any
+    Solver movegen = Solver(0);        // Only used for candidateMoves
+
+    // Deals the unseen cards of a state into its unseen positions at random
+    void determinize(unsigned char * state, const bool * known, unsigned int * randstate)
+    {
+        std::vector<int> positions;
+        for(int i = 0; i < STATE_CARDS; i++)
+        {
+            if(state[i] != 0 && !known[(state[i] & 0x7F) - 1])
+            {
+                positions.push_back(i);
+            }
+        }
+        for(int i = (int) positions.size() - 1; i > 0; i--)
+        {
+            int j = rand_r(randstate) % (i + 1);
+            unsigned char a = state[positions[i]] & 0x7F;
+            unsigned char b = state[positions[j]] & 0x7F;
+            state[positions[i]] = (state[positions[i]] & 0x80) | b;
+            state[positions[j]] = (state[positions[j]] & 0x80) | a;
+        }
+    }
+
+    // Marks the cards the player can see on board as seen, the lock must be held
+    void markSeen(GameBoard * board)
+    {
+        unsigned char state[STATE_SIZE];
+        board->saveState(state);
+
+        // Stock cards are stored face up, so only drawn ones count as seen
+        for(int i = KlondikeRules::DISCARD_CARDS; i < STATE_CARDS; i++)
+        {
+            if(state[i] & 0x80)
+            {
+                seen[(state[i] & 0x7F) - 1] = true;
+            }
+        }
+        for(int x = 0; x <= board->lastDrawn(); x++)
+        {
+            seen[board->cardAt(KlondikeRules::DISCARD, x)->getID()] = true;
+        }
+    }
+
+    // Samples positions until stopped
+    void work(unsigned int randstate)
+    {
+        GameBoard * board = new GameBoard(drawtype, 0u);
+        Solver * solver = new Solver(nodelimit);
+        solver->setTablebase(tablebase);
+        unsigned char state[STATE_SIZE];
+        bool known[KlondikeRules::CARDS];
+        std::unique_lock<std::mutex> guard(lock);
+        while(!stopping)
+        {
+            // Sample the position, or the move, with the fewest samples started
+            int arm = -1;
+            for(size_t i = 0; haveroot && i < taken.size(); i++)
+            {
+                if(taken[i] < maxsamples && (arm == -1 || taken[i] < taken[arm]))
+                {
+                    arm = i;
+                }
+            }
+            if(arm == -1)
+            {
+                metricsFlush();
+                changed.wait(guard);
+                continue;
+            }
+            taken[arm]++;
+            int gen = generation;
+            Move move = arm > 0 ? moves[arm - 1] : Move();
+            memcpy(state, root, STATE_SIZE);
+            memcpy(known, seen, sizeof(known));
+            guard.unlock();
+
+            TRACE_SPAN("sample");
+            determinize(state, known, &randstate);
+            board->loadState(state);
+            solver->reset();
+            bool won = (arm == 0 || board->applyMove(move)) && solver->search(board);
+
+            guard.lock();
+            if(gen == generation)
+            {
+                samples[arm]++;
+                wins[arm] += won;
+            }
+        }
+        guard.unlock();
+        metricsFlush();
+        board->deallocate();
+        delete board;
+        delete solver;
+    }
+public:
+    Estimator(int dt, long limit, int max)
+    {
+        drawtype = dt;
+        nodelimit = limit;
+        maxsamples = max;
+        for(int i = 0; i < KlondikeRules::CARDS; i++)
+        {
+            seen[i] = false;
+        }
+    }
+
+    ~Estimator()
+    {
+        stop();
+    }
+
+    // Makes the solvers look up late game positions in tb, must be called before start
+    void setTablebase(Tablebase * tb)
+    {
+        tablebase = tb;
+    }
+
+    // Starts one worker for each core
+    void start()
+    {
+        unsigned int threadcount = std::thread::hardware_concurrency();
+        if(threadcount == 0)
+        {
+            threadcount = 1;
+        }
+        unsigned int base = time(NULL);
+        for(unsigned int t = 0; t < threadcount; t++)
+        {
+            workers.push_back(std::thread(&Estimator::work, this, base + t * 7919));
+        }
+    }
+
+    // Stops and joins the workers
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        changed.notify_all();
+        for(size_t i = 0; i < workers.size(); i++)
+        {
+            workers[i].join();
+        }
+        workers.clear();
+    }
+
+    // Marks every card the player has seen in a game as seen, by replaying its history from
+    // the deal on a copy of board, so an estimator started late or in a resumed game knows
+    // the cards seen before it. Moves undone by seeking are replayed too, since the player
+    // saw what they turned over
+    void seeHistory(History * history, GameBoard * board)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        GameBoard * replay = board->clone();
+        replay->loadState(history->getCheckpoints());
+        replay->boardRefresh();
+        markSeen(replay);
+        const std::vector<Move> & played = history->getMoves();
+        for(size_t i = 0; i < played.size(); i++)
+        {
+            replay->applyMove(played[i]);
+            replay->boardRefresh();
+            markSeen(replay);
+        }
+        replay->deallocate();
+        delete replay;
+    }
+
+    // Replaces the position being sampled with the current state of board
+    void update(GameBoard * board)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        board->saveState(root);
+        markSeen(board);
+
+        // Moves the engine would reject are left out, which does not depend on the hidden cards
+        movegen.candidateMoves(board, moves);
+        for(size_t i = 0; i < moves.size();)
+        {
+            GameBoard * child = board->clone();
+            if(child->applyMove(moves[i]))
+            {
+                i++;
+            }
+            else
+            {
+                moves.erase(moves.begin() + i);
+            }
+            child->deallocate();
+            delete child;
+        }
+        generation++;
+        taken.assign(moves.size() + 1, 0);
+        samples.assign(moves.size() + 1, 0);
+        wins.assign(moves.size() + 1, 0);
+        haveroot = true;
+        changed.notify_all();
+    }
+
+    // Returns the estimate for the current position so far
+    Estimate get()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Estimate estimate;
+        estimate.samples = haveroot ? samples[0] : 0;
+        estimate.wins = haveroot ? wins[0] : 0;
+        estimate.winrate = estimate.samples > 0 ? (double) estimate.wins / estimate.samples : 0;
+        wilsonInterval(estimate.wins, estimate.samples, estimate.low, estimate.high);
+        estimate.best = -1;
+        for(size_t i = 0; haveroot && i < moves.size(); i++)
+        {
+            MoveEstimate move;
+            move.move = moves[i];
+            move.samples = samples[i + 1];
+            move.wins = wins[i + 1];
+            move.winrate = move.samples > 0 ? (double) move.wins / move.samples : 0;
+            wilsonInterval(move.wins, move.samples, move.low, move.high);
+            estimate.moves.push_back(move);
+
+            // Ties go to the move with more samples, whose rate is surer
+            if
+            (
+                move.samples > 0 &&
+                (
+                    estimate.best == -1 ||
+                    move.winrate > estimate.moves[estimate.best].winrate ||
+                    (move.winrate == estimate.moves[estimate.best].winrate && move.samples > estimate.moves[estimate.best].samples)
+                )
+            )
+            {
+                estimate.best = i;
+            }
+        }
+        return estimate;
+    }
+};
+
+#endif
@@ -0,0 +1,1300 @@
+#ifndef GAMEBOARD_H
+#define GAMEBOARD_H
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <ncurses.h>
+#include <vector>
+#include "dealdb.h"
+#include "metrics.h"
+#include "screen.h"
+#include "trace.h"
+
+static const char vals[15] = " A23456789TJQK"; // All possible values of a card
+static const char suits[5] = "cdhs";           // All possible suits of a card
+
+// Vector struct
+typedef struct
+{
+    int y;
+    int x;
+} Vector;
+
+// Move struct, a draw is stored with a boardy of -1
+typedef struct
+{
+    int boardy;    // Row of the selected card
+    int boardx;    // Column of the selected card
+    int pileindex; // Destination pile
+} Move;
+
+// Card class
+class Card
+{
+private:
+    int val;          // Number value of the card
+    char suit;        // The suit of the card
+    bool revealed;    // Is the card face-up?
+    bool placeholder; // Is the card a placeholder?
+public:
+    // Constructor method for a placeholder card
+    Card() 
+    {
+        val = 0;
+        suit = ' ';
+        revealed = true;
+        placeholder = true;
+    }
+
+    // Constructor method for a non-placeholder card
+    Card(int v, char s, bool r) // v is val, s is suit, r is revealed
+    {
+        val = v;
+        suit = s;
+        revealed = r;
+        placeholder = false;
+    }
+
+    // Flips a card face up
+    void reveal() 
+    {
+        revealed = true;
+    }
+
+    // Returns int version of the card's value
+    int getIVal()
+    {
+        return val;
+    }
+
+    // Returns suit of the card as a char
+    char getSuit() 
+    {
+        return suit;
+    }
+
+    // Returns char version of a card's value for use with user interaction
+    char getCVal()
+    {
+        return vals[val];
+    }
+
+    // Returns the color of a card
+    char getColor()
+    {
+        if(suit == 's' || suit == 'c' || getPH() || !getRevealed())
+        {
+            return 'b';
+        }
+        else if(suit == 'd' || suit == 'h')
+        {
+            return 'r';
+        }
+        return ' ';
+    }
+
+    // Returns a boolean representing whether a card is flipped
+    bool getRevealed() 
+    {
+        return revealed;
+    }
+
+    // Returns a boolean representing if a card is a placeholder or not
+    bool getPH()
+    {
+        return placeholder;
+    }
+
+    // Sets whether a card is face up, used when restoring a saved board
+    void setRevealed(bool r)
+    {
+        revealed = r;
+    }
+
+    // Returns a number from 0 to 51 that is unique to the card's value and suit
+    int getID()
+    {
+        return (val - 1) * 4 + (int) (strchr(suits, suit) - suits);
+    }
+
+    // Returns a boolean representing the equality of two cards
+    bool equals(Card * card)
+    {
+        if(card->getCVal() == getCVal() && card->getSuit() == getSuit())
+        {
+            return true;
+        }
+        return false;
+    }
+};
+
+// Kinds of pile a rules policy can lay out
+enum PileKind
+{
+    discardpile,    // The stock, drawn face up from left to right
+    foundationpile, // Built up by suit from the Ace
+    tableaupile     // Built down, cards can be face down
+};
+
+// Slots in each pile of the rules policies below, in the order of their rows
+// A tableau pile holds its face down cards and a run from the King to the Ace, and every
+// pile keeps a slot for the placeholder after its last card
+static constexpr int klondikeCapacities[12] = {25, 14, 14, 14, 14, 20, 20, 20, 20, 20, 20, 20};
+static constexpr int sixPileCapacities[11] = {32, 14, 14, 14, 14, 19, 19, 19, 19, 19, 19};
+
+// Rules policy for Klondike
+// A rules policy gives BasicGameBoard the layout and rules of a variant at compile time,
+// so the board's loops and checks compile to the same code as hardcoded ones
+// Piles are in the order discard, foundation, tableau
+// The engine still assumes a stock that is drawn into a single discard row, so variants
+// without one, such as FreeCell, need more than a new policy
+struct KlondikeRules
+{
+    enum
+    {
+        PILES = 12,           // Number of piles, the rows of GB
+        DISCARD = 0,          // Row of the stock and discard, the cards not dealt to the tableau
+        FIRST_FOUNDATION = 1, // Row of the first foundation pile
+        FIRST_TABLEAU = 5,    // Row of the first tableau pile, the rest of the rows are tableau too
+        CARDS = 52,           // Cards in the deck
+        SUITS = 4,            // Suits in the deck, the first SUITS of suits
+        SUIT_CARDS = 13,      // Cards of each suit, the number in a full foundation pile
+        SHOWN_DRAWN = 3,      // Drawn cards shown in the discard, only the last can be played
+        STOCK_CARDS = 24,     // Cards dealt to the discard
+        DISCARD_CARDS = 25,   // Slots in the discard
+        COLUMNS = 19,         // Slots shown for each pile
+        SLOTS = 221           // Slots in every pile together, BasicGameBoard checks it against capacity
+    };
+
+    // Returns the kind of pile in row y
+    static constexpr PileKind kind(int y)
+    {
+        return y < FIRST_FOUNDATION ? discardpile : y < FIRST_TABLEAU ? foundationpile : tableaupile;
+    }
+
+    // Returns the number of slots in row y
+    static constexpr int capacity(int y)
+    {
+        return klondikeCapacities[y];
+    }
+
+    // Returns the name of row y
+    static const char * name(int y)
+    {
+        static const char names[PILES][3] = {"DS", "F1", "F2", "F3", "F4", "P1", "P2", "P3", "P4", "P5", "P6", "P7"};
+        return names[y];
+    }
+
+    // Returns the number of cards dealt to tableau row y
+    static constexpr int dealt(int y)
+    {
+        return y - FIRST_TABLEAU + 1;
+    }
+
+    // Turns over the next drawtype cards of a stock whose first maxdraw + 1 slots of the
+    // discard hold cards, marking them in drawn, returns false if every card is drawn and
+    // the discard should be turned back over
+    static bool draw(bool * drawn, int maxdraw, int drawtype)
+    {
+        int startpoint = -1;
+        for(int i = 0; i <= maxdraw; i++) // Find where the undrawn card is
+        {
+            if(!drawn[i])
+            {
+                startpoint = i;
+                break;
+            }
+        }
+        if(startpoint == -1)
+        {
+            return false;
+        }
+        for(int i = startpoint; i < startpoint + drawtype; i++)
+        {
+            if(i > maxdraw)
+            {
+                break;
+            }
+            drawn[i] = true;
+        }
+        return true;
+    }
+
+    // Returns true if card can go on a foundation pile whose last card is top
+    static bool foundationAccepts(Card * top, Card * card)
+    {
+        if(top->getPH())
+        {
+            return card->getIVal() == 1;
+        }
+        return top->getSuit() == card->getSuit() && top->getIVal() == card->getIVal() - 1;
+    }
+
+    // Returns true if card can go on a tableau pile whose last card is top
+    static bool tableauAccepts(Card * top, Card * card)
+    {
+        if(top->getPH())
+        {
+            return card->getIVal() == 13;
+        }
+        return top->getColor() != card->getColor() && top->getIVal() == card->getIVal() + 1;
+    }
+};
+
+// Rules for Klondike dealt to six tableau piles instead of seven, which leaves a longer stock
+// Every pile size differs from Klondike's, so difftest plays it to check that the engine
+// takes its sizes from the policy
+struct SixPileRules : KlondikeRules
+{
+    enum
+    {
+        PILES = 11,
+        STOCK_CARDS = 31,
+        DISCARD_CARDS = 32,
+        SLOTS = 202
+    };
+
+    // Returns the number of slots in row y
+    static constexpr int capacity(int y)
+    {
+        return sixPileCapacities[y];
+    }
+};
+
+// Returns the number of slots in rows y to the last one of a rules policy
+template <typename Rules>
+constexpr int slotsFrom(int y)
+{
+    return y == Rules::PILES ? 0 : Rules::capacity(y) + slotsFrom<Rules>(y + 1);
+}
+
+// Returns the number of cards dealt to the tableau rows y to the last one of a rules policy
+template <typename Rules>
+constexpr int dealtFrom(int y)
+{
+    return y == Rules::PILES ? 0 : Rules::dealt(y) + dealtFrom<Rules>(y + 1);
+}
+
+// Solitaire engine for the variant described by Rules
+template <typename Rules>
+class BasicGameBoard
+{
+    static_assert(Rules::SLOTS == slotsFrom<Rules>(0), "SLOTS must be the sum of the pile capacities");
+    static_assert(Rules::kind(Rules::DISCARD) == discardpile && Rules::capacity(Rules::DISCARD) == Rules::DISCARD_CARDS, "The discard must hold DISCARD_CARDS slots");
+    static_assert(Rules::STOCK_CARDS < Rules::DISCARD_CARDS, "The discard needs a slot for the placeholder after the stock");
+    static_assert(Rules::STOCK_CARDS + dealtFrom<Rules>(Rules::FIRST_TABLEAU) == Rules::CARDS, "Every card must be dealt");
+public:
+    enum
+    {
+        STATE_BYTES = Rules::SLOTS + (Rules::DISCARD_CARDS + 7) / 8 + 5, // Number of bytes written by saveState
+        SCREEN_WIDTH = 3 + 4 * Rules::COLUMNS // Pile name, a space, then a bracketed slot for each column
+    };
+    typedef BasicScreen<Rules::PILES, SCREEN_WIDTH> Screen; // Grid the board is laid out into
+private:
+    int points = 0;                     // Current score
+    int maxdraw = Rules::STOCK_CARDS - 1; // An inclusive number for the max index of drawn cards
+    int drawtype;                       // An int representing the draw type of the game (1 or 3)
+    unsigned int seed;                  // Seed used to shuffle the deck
+    bool drawncards[Rules::DISCARD_CARDS]; // true for drawn cards, false for not
+    Card * PH = new Card();             // Placeholder card to prevent segfaults
+    Card ** allcards = new Card * [Rules::CARDS]; // Original 52 cards
+    Card *** GB = new Card ** [Rules::PILES];     // 12 rows of varying length card piles
+    Card * byid[Rules::CARDS];                    // The cards in allcards indexed by Card::getID
+
+    Vector locationOf(Card * card)
+    {
+        Vector location;
+        location.y = -1;
+        location.x = -1;
+        for(int y = 0; y < Rules::PILES; y++)
+        {
+            for(int x = 0; x < Rules::capacity(y); x++)
+            {
+                if(GB[y][x]->equals(card))
+                {
+                    location.y = y;
+                    location.x = x;
+                    return location;
+                }
+            }
+        }
+        return location;
+    }
+
+    Vector locationOf(Card * card, int y)
+    {
+        Vector location;
+        location.y = y;
+        location.x = -1;
+        for(int x = 0; x < Rules::capacity(y); x++)
+        {
+            if(GB[y][x]->equals(card))
+            {
+                location.x = x;
+                return location;
+            }
+        }
+        return location;
+    }
+
+    // Makes last in drawncards false and decrease maximum cards by 1
+    void decreaseDrawMax()
+    {
+        if(--maxdraw < -1)
+        {
+            maxdraw = -1;
+        }
+        if(maxdraw != -1)
+        {
+            for(int i = Rules::DISCARD_CARDS - 1; i >= 0; i--)
+            {
+                if(drawncards[i])
+                {
+                    drawncards[i] = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Make all items in drawncards false
+    void undraw()
+    {
+        for(int i = 0; i < Rules::DISCARD_CARDS; i++)
+        {
+            drawncards[i] = false;
+        }
+    }
+
+    // Shuffles and deals the cards for a given seed
+    void deal(unsigned int s)
+    {
+        seed = s;
+        unsigned int randstate = s;
+
+        // Generate random indices
+        bool repeating = true;
+        int randnums[Rules::CARDS];
+        int i;
+        for(i = 0; i < Rules::CARDS; i++)
+        {
+            randnums[i] = rand_r(&randstate) % Rules::CARDS;
+        }
+        while(repeating)
+        {
+            repeating = false;
+            for(i = 0; i < Rules::CARDS; i++)
+            {
+                for(int j = 0; j < Rules::CARDS; j++)
+                {
+                    if(j != i && randnums[j] == randnums[i])
+                    {
+                        randnums[j] = rand_r(&randstate) % Rules::CARDS;
+                        repeating = true;
+                    }
+                }
+            }
+        }
+
+        // Create 52 cards
+        i = 0;
+        for(int v = 0; v < Rules::SUIT_CARDS; v++)
+        {
+            for(int s = 0; s < Rules::SUITS; s++)
+            {
+                allcards[randnums[i++]] = new Card(v + 1, suits[s], false);
+            }
+        }
+        for(i = 0; i < Rules::CARDS; i++)
+        {
+            byid[allcards[i]->getID()] = allcards[i];
+        }
+
+        // Add piles to GB's rows
+        for(i = 0; i < Rules::PILES; i++)
+        {
+            GB[i] = new Card * [Rules::capacity(i)];
+        }
+
+        // Add PH to GB
+        for(int y = 0; y < Rules::PILES; y++)
+        {
+            for(int x = 0; x < Rules::capacity(y); x++)
+            {
+                GB[y][x] = PH;
+            }
+        }
+
+        // Add cards to tableau
+        int count = 0;
+        for(int y = Rules::FIRST_TABLEAU; y < Rules::PILES; y++)
+        {
+            for(int x = 0; x < Rules::dealt(y); x++)
+            {
+                GB[y][x] = allcards[count++];
+            }
+        }
+
+        // Add cards to discard
+        for(i = 0; i < Rules::STOCK_CARDS; i++)
+        {
+            allcards[count]->reveal();
+            GB[Rules::DISCARD][i] = allcards[count++];
+        }
+
+        // Make all cards not drawn
+        for(i = 0; i < Rules::DISCARD_CARDS; i++)
+        {
+            drawncards[i] = false;
+        }
+    }
+
+    // Sets row y of a grid to the pile name, colored for the pile cursor, and empty slots
+    void layoutRow(Screen & screen, int y, bool pilesel, int pileindex)
+    {
+        static const std::vector<char> slots = emptySlots();
+        screen.fillRow(y, slots.data());
+        screen.text[y][0] = Rules::name(y)[0];
+        screen.text[y][1] = Rules::name(y)[1];
+        if(pilesel && pileindex == y)
+        {
+            screen.pairs[y][0] = 3;
+            screen.pairs[y][1] = 3;
+        }
+    }
+
+    // Returns a row of a grid with a bracketed, empty slot for each column after the name
+    static std::vector<char> emptySlots()
+    {
+        std::vector<char> line(SCREEN_WIDTH, ' ');
+        for(int n = 0; n < Rules::COLUMNS; n++)
+        {
+            line[3 + 4 * n] = '[';
+            line[6 + 4 * n] = ']';
+        }
+        return line;
+    }
+
+    // Returns the color pair of a card, 3 or 4 under the card cursor, 2 for a face up red card
+    static int pairOf(Card * card, bool selected)
+    {
+        if(selected)
+        {
+            return card->getColor() == 'b' ? 3 : 4;
+        }
+        return card->getColor() == 'b' || !card->getRevealed() ? 1 : 2;
+    }
+
+    // Constructor method for a copy of another board
+    BasicGameBoard(BasicGameBoard * other)
+    {
+        points = other->points;
+        maxdraw = other->maxdraw;
+        drawtype = other->drawtype;
+        seed = other->seed;
+        for(int i = 0; i < Rules::DISCARD_CARDS; i++)
+        {
+            drawncards[i] = other->drawncards[i];
+        }
+        for(int i = 0; i < Rules::CARDS; i++)
+        {
+            allcards[i] = new Card(*other->allcards[i]);
+            byid[allcards[i]->getID()] = allcards[i];
+        }
+        for(int y = 0; y < Rules::PILES; y++)
+        {
+            GB[y] = new Card * [Rules::capacity(y)];
+            for(int x = 0; x < Rules::capacity(y); x++)
+            {
+                if(other->GB[y][x]->getPH())
+                {
+                    GB[y][x] = PH;
+                }
+                else
+                {
+                    GB[y][x] = byid[other->GB[y][x]->getID()];
+                }
+            }
+        }
+    }
+public:
+    // Constructor method for a board shuffled from the current time
+    BasicGameBoard(int dt)
+    {
+        drawtype = dt;
+        deal(time(NULL));
+    }
+
+    // Constructor method for a board shuffled from a given seed
+    BasicGameBoard(int dt, unsigned int s)
+    {
+        drawtype = dt;
+        deal(s);
+    }
+
+    // Constructor method for a board restored from a state written by saveState
+    // The deck is not shuffled, s is only kept for getSeed
+    BasicGameBoard(int dt, unsigned int s, const unsigned char * state)
+    {
+        drawtype = dt;
+        seed = s;
+        for(int i = 0; i < Rules::CARDS; i++)
+        {
+            allcards[i] = new Card(i / Rules::SUITS + 1, suits[i % Rules::SUITS], false);
+            byid[i] = allcards[i];
+        }
+        for(int i = 0; i < Rules::PILES; i++)
+        {
+            GB[i] = new Card * [Rules::capacity(i)];
+        }
+        loadState(state);
+    }
+
+    // Constructor method for a board shuffled from a winnable seed in deals, if it has any
+    BasicGameBoard(int dt, DealDB * deals)
+    {
+        drawtype = dt;
+        if(deals != nullptr && deals->winnableCount(dt) > 0)
+        {
+            unsigned int randstate = time(NULL);
+            deal(deals->randomWinnable(dt, &randstate));
+        }
+        else
+        {
+            deal(time(NULL));
+        }
+    }
+
+    // Returns a new board with the same state, which must be deallocated and deleted by the caller
+    BasicGameBoard * clone()
+    {
+        return new BasicGameBoard(this);
+    }
+
+    // Returns the seed the board was shuffled from
+    unsigned int getSeed()
+    {
+        return seed;
+    }
+
+    // Returns the draw type of the game (1 or 3)
+    int getDrawType()
+    {
+        return drawtype;
+    }
+
+    // Returns the card at a position in the gameboard
+    Card * cardAt(int y, int x)
+    {
+        return GB[y][x];
+    }
+
+    // Returns the index of the last drawn card in the discard, -1 if no cards are drawn
+    int lastDrawn()
+    {
+        for(int x = Rules::DISCARD_CARDS - 1; x >= 0; x--)
+        {
+            if(drawncards[x])
+            {
+                return x;
+            }
+        }
+        return -1;
+    }
+
+    // Returns the column a move takes the last drawn card from, as the discard shows it,
+    // -1 if no cards are drawn
+    int drawnColumn()
+    {
+        int x = lastDrawn();
+        return x > Rules::SHOWN_DRAWN - 1 ? Rules::SHOWN_DRAWN - 1 : x;
+    }
+
+    // Returns the last card in a given pile
+    Card * last(int y)
+    {
+        if(Rules::kind(y) != discardpile)
+        {
+            for(int x = Rules::capacity(y) - 1; x >= 0; x--)
+            {
+                if(!GB[y][x]->getPH())
+                {
+                    return GB[y][x];
+                }
+            }
+            return GB[y][0];
+        }
+        else
+        {
+            for(int x = Rules::DISCARD_CARDS - 1; x >= 0; x--)
+            {
+                if(drawncards[x])
+                {
+                    return GB[Rules::DISCARD][x];
+                }
+            }
+            return GB[Rules::DISCARD][0];
+        }
+    }
+
+    // Checks and fixes the gameboard
+    void boardRefresh()
+    {
+        TRACE_SPAN("boardRefresh");
+        // Checks for null pointers and replaces with placeholder
+        for(int y = 0; y < Rules::PILES; y++)
+        {
+            for(int x = 0; x < Rules::capacity(y); x++)
+            {
+                if(GB[y][x] == nullptr)
+                {
+                    GB[y][x] = PH;
+                }
+            }
+        }
+
+        // Checks for reveals last cards in tableau
+        for(int y = Rules::FIRST_TABLEAU; y < Rules::PILES; y++)
+        {
+            last(y)->reveal();
+        }
+
+        // Shifts all cards in discard to the left if a card is missing/moved
+        int startpoint = -1;
+        for(int x = 0; x <= maxdraw; x++)
+        {
+            if(GB[Rules::DISCARD][x]->getPH() && !GB[Rules::DISCARD][x + 1]->getPH())
+            {
+                startpoint = x;
+                break;
+            }
+        }
+        if(startpoint != -1)
+        {
+            for(int x = startpoint; x <= maxdraw; x++)
+            {
+                GB[Rules::DISCARD][x] = GB[Rules::DISCARD][(x + 1)];
+                GB[Rules::DISCARD][(x + 1)] = PH;
+            }
+        }
+    }
+
+    // Writes the whole board into STATE_BYTES bytes of buf
+    void saveState(unsigned char * buf)
+    {
+        int n = 0;
+        for(int y = 0; y < Rules::PILES; y++)
+        {
+            for(int x = 0; x < Rules::capacity(y); x++)
+            {
+                if(GB[y][x]->getPH())
+                {
+                    buf[n++] = 0;
+                }
+                else
+                {
+                    buf[n++] = (GB[y][x]->getID() + 1) | (GB[y][x]->getRevealed() ? 0x80 : 0);
+                }
+            }
+        }
+        for(int i = 0; i < (Rules::DISCARD_CARDS + 7) / 8; i++)
+        {
+            buf[n + i] = 0;
+        }
+        for(int i = 0; i < Rules::DISCARD_CARDS; i++)
+        {
+            if(drawncards[i])
+            {
+                buf[n + i / 8] |= 1 << (i % 8);
+            }
+        }
+        n += (Rules::DISCARD_CARDS + 7) / 8;
+        buf[n++] = maxdraw + 1;
+        for(int i = 0; i < 4; i++)
+        {
+            buf[n++] = (points >> (8 * i)) & 0xFF;
+        }
+    }
+
+    // Restores the whole board from STATE_BYTES bytes written by saveState
+    void loadState(const unsigned char * buf)
+    {
+        int n = 0;
+        for(int y = 0; y < Rules::PILES; y++)
+        {
+            for(int x = 0; x < Rules::capacity(y); x++, n++)
+            {
+                if(buf[n] == 0)
+                {
+                    GB[y][x] = PH;
+                }
+                else
+                {
+                    GB[y][x] = byid[(buf[n] & 0x7F) - 1];
+                    GB[y][x]->setRevealed((buf[n] & 0x80) != 0);
+                }
+            }
+        }
+        for(int i = 0; i < Rules::DISCARD_CARDS; i++)
+        {
+            drawncards[i] = (buf[n + i / 8] >> (i % 8)) & 1;
+        }
+        n += (Rules::DISCARD_CARDS + 7) / 8;
+        maxdraw = buf[n++] - 1;
+        points = 0;
+        for(int i = 0; i < 4; i++)
+        {
+            points |= buf[n++] << (8 * i);
+        }
+    }
+
+    // Returns true if a move only reads and writes inside the board, as the cursor's moves do
+    // Tableau moves look at the slot after boardx, so it must not be the last slot
+    static bool validMove(Move move)
+    {
+        if(move.boardy == -1)
+        {
+            return true;
+        }
+        if(move.boardy < 0 || move.boardy >= Rules::PILES || move.pileindex < 0 || move.pileindex >= Rules::PILES)
+        {
+            return false;
+        }
+        int width = Rules::capacity(move.boardy) - (Rules::kind(move.boardy) == tableaupile ? 1 : 0);
+        return move.boardx >= 0 && move.boardx < width;
+    }
+
+    // Returns true if STATE_BYTES bytes of buf are a state the engine can play from: every
+    // card is in exactly one slot, each foundation pile is a run of one suit up from the Ace,
+    // and the drawn cards are the first ones in the discard and no more than the draw limit
+    // allows. This catches damaged states without replaying a game, not every state that
+    // play cannot reach
+    static bool validState(const unsigned char * buf)
+    {
+        bool placed[Rules::CARDS] = {};
+        int cards = 0;
+        int n = 0;
+        for(int y = 0; y < Rules::PILES; y++)
+        {
+            int suit = -1;
+            for(int x = 0; x < Rules::capacity(y); x++, n++)
+            {
+                if(buf[n] == 0)
+                {
+                    suit = Rules::kind(y) == foundationpile ? Rules::SUITS : suit;
+                    continue;
+                }
+                int id = (buf[n] & 0x7F) - 1;
+                if(id < 0 || id >= Rules::CARDS || placed[id])
+                {
+                    return false;
+                }
+                placed[id] = true;
+                cards++;
+                if(Rules::kind(y) == foundationpile)
+                {
+                    // Card ids are (rank - 1) * SUITS + suit, see Card::getID
+                    if(id / Rules::SUITS != x || (x > 0 && id % Rules::SUITS != suit) || !(buf[n] & 0x80))
+                    {
+                        return false;
+                    }
+                    suit = id % Rules::SUITS;
+                }
+            }
+        }
+        int maxdraw = buf[n + (Rules::DISCARD_CARDS + 7) / 8] - 1;
+        if(cards != Rules::CARDS || maxdraw < -1 || maxdraw >= Rules::STOCK_CARDS)
+        {
+            return false;
+        }
+        int drawn = 0;
+        for(int i = 0; i < Rules::DISCARD_CARDS; i++)
+        {
+            if((buf[n + i / 8] >> (i % 8)) & 1)
+            {
+                if(drawn != i)
+                {
+                    return false;
+                }
+                drawn++;
+            }
+        }
+
+        // Taking the last drawn card lowers the limit, but the stock's last card keeps its mark
+        return drawn <= (maxdraw + 1 > 1 ? maxdraw + 1 : 1);
+    }
+
+    // Returns a 64 bit FNV-1a hash of the board's state
+    unsigned long long hashState()
+    {
+        unsigned char buf[STATE_BYTES];
+        saveState(buf);
+        unsigned long long h = 14695981039346656037ULL;
+        for(int i = 0; i < STATE_BYTES; i++)
+        {
+            h = (h ^ buf[i]) * 1099511628211ULL;
+        }
+        return h;
+    }
+
+    // Returns a bool representing whether a game is won or not
+    bool isWon()
+    {
+        for(int y = Rules::FIRST_FOUNDATION; y < Rules::FIRST_TABLEAU; y++)
+        {
+            for(int x = 0; x < Rules::SUIT_CARDS; x++)
+            {
+                if(GB[y][x]->getPH())
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Moves selected card to selected pile if possible and returns true if successful, false if not
+    bool moveCard(int boardy, int boardx, int pileindex)
+    {
+        TRACE_SPAN("moveCard");
+        // Immediate movement disqualifiers
+        if
+        (
+            Rules::kind(pileindex) == discardpile ||
+            boardy == pileindex ||
+            GB[boardy][boardx]->getPH() ||
+            !GB[boardy][boardx]->getRevealed() ||
+            (Rules::kind(boardy) == foundationpile && boardx != 0) ||
+            (Rules::kind(boardy) == discardpile && !drawncards[boardx])
+        )
+        {
+            return false;
+        }
+        // Checks for movement based on valid locations
+        if(Rules::kind(boardy) == discardpile) // Movement from discard
+        {
+            int lastcard = -1;
+            for(int i = Rules::DISCARD_CARDS - 1; i >= 0; i--)
+            {
+                if(GB[Rules::DISCARD][i]->equals(last(Rules::DISCARD)))
+                {
+                    lastcard = i;
+                }
+            }
+            if((lastcard > Rules::SHOWN_DRAWN - 1 && boardx == Rules::SHOWN_DRAWN - 1) || lastcard == boardx) // Valid movement from discard
+            {
+                if(Rules::kind(pileindex) == foundationpile) // Move to foundation
+                {
+                    if(last(pileindex)->getPH() && Rules::foundationAccepts(last(pileindex), last(Rules::DISCARD))) // Valid move
+                    {
+                        GB[pileindex][0] = last(Rules::DISCARD);
+                        GB[locationOf(last(Rules::DISCARD)).y][locationOf(last(Rules::DISCARD)).x] = PH;
+                        decreaseDrawMax();
+                        return true;
+                    }
+                    else if(Rules::foundationAccepts(last(pileindex), last(Rules::DISCARD)))
+                    {
+                        GB[pileindex][locationOf(last(pileindex)).x + 1] = last(Rules::DISCARD);
+                        GB[locationOf(last(Rules::DISCARD)).y][locationOf(last(Rules::DISCARD)).x] = PH;
+                        decreaseDrawMax();
+                        return true;
+                    }
+                }
+                else if(Rules::kind(pileindex) == tableaupile) // Movement to tableau
+                {
+                    if(last(pileindex)->getPH() && Rules::tableauAccepts(last(pileindex), last(boardy)))
+                    {
+                        GB[pileindex][0] = last(boardy);
+                        GB[locationOf(last(boardy)).y][locationOf(last(boardy)).x] = PH;
+                        decreaseDrawMax();
+                        return true;
+                    }
+                    for(int x = 0; x < Rules::capacity(pileindex); x++)
+                    {
+                        if
+                        (
+                            GB[pileindex][x]->getPH() && 
+                            !last(pileindex)->getPH() &&
+                            Rules::tableauAccepts(last(pileindex), last(boardy))
+                        ) // Valid movement
+                        {
+                            GB[pileindex][x] = last(boardy);
+                            GB[locationOf(last(boardy)).y][locationOf(last(boardy)).x] = PH;
+                            decreaseDrawMax();
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        else if(Rules::kind(boardy) == foundationpile) // Movement from foundation
+        {
+            if(Rules::kind(pileindex) == tableaupile) // Movement to tableau
+            {
+                for(int x = 0; x < Rules::capacity(pileindex); x++)
+                {
+                    if
+                    (
+                        GB[pileindex][x]->getPH() && 
+                        !last(pileindex)->getPH() &&
+                        Rules::tableauAccepts(last(pileindex), last(boardy))
+                    ) // Valid movement
+                    {
+                        GB[pileindex][x] = last(boardy);
+                        GB[locationOf(last(boardy)).y][locationOf(last(boardy)).x] = PH;
+                        return true;
+                    }
+                }
+            }
+        }
+        else if(Rules::kind(boardy) == tableaupile) // Movement from tableau
+        {
+            if(Rules::kind(pileindex) == foundationpile) // Movement to foundation
+            {
+                if(last(pileindex)->getPH() && Rules::foundationAccepts(last(pileindex), last(boardy))) // Valid move
+                    {
+                        GB[pileindex][0] = last(boardy);
+                        GB[boardy][boardx] = PH;
+                        return true;
+                    }
+                    else if(Rules::foundationAccepts(last(pileindex), last(boardy)))
+                    {
+                        GB[pileindex][locationOf(last(pileindex)).x + 1] = last(boardy);
+                        GB[boardy][boardx] = PH;
+                        return true;
+                    }
+            }
+            else if(Rules::kind(pileindex) == tableaupile) // Movement to tableau
+            {
+                bool singlecard = false;
+                if(GB[boardy][boardx + 1]->getPH())
+                {
+                    singlecard = true;
+                }
+                if(last(pileindex)->getPH() && Rules::tableauAccepts(last(pileindex), GB[boardy][boardx])) // Valid movement with King to empty spot
+                {
+                    for(int x = boardx; x < Rules::capacity(boardy); x++)
+                    {
+                        if(!GB[boardy][x]->getPH())
+                        {
+                            GB[pileindex][x - boardx] = GB[boardy][x];
+                            GB[boardy][x] = PH;
+                        }
+                        else
+                        {
+                            break;
+                        }
+                    }
+                    return true;
+                }
+                else if(!last(pileindex)->getPH() && Rules::tableauAccepts(last(pileindex), GB[boardy][boardx])) // Valid movement of non-king card
+                {
+                    if(singlecard)
+                    {
+                        GB[locationOf(last(pileindex)).y][locationOf(last(pileindex)).x + 1] = GB[boardy][boardx];
+                        GB[boardy][boardx] = PH;
+                        return true;
+                    }
+                    else // if moving multiple cards
+                    {
+                        for(int x = boardx; x < Rules::capacity(boardy); x++)
+                        {
+                            if(!GB[boardy][x]->getPH())
+                            {
+                                GB[pileindex][(locationOf(PH, pileindex).x)] = GB[boardy][x];
+                                GB[boardy][x] = PH;
+                            }
+                            else
+                            {
+                                break;
+                            }
+                        }
+                        return true;
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // Applies a move or draw and fixes the gameboard, returns true if successful, false if not
+    bool applyMove(Move move)
+    {
+        bool moved = true;
+        metricsCount(movesapplied);
+        if(move.boardy == -1)
+        {
+            draw();
+        }
+        else
+        {
+            moved = moveCard(move.boardy, move.boardx, move.pileindex);
+        }
+        boardRefresh();
+        return moved;
+    }
+
+    // Returns the rank of the highest card of a suit in the foundation, 0 if there is none
+    int foundationRank(char suit)
+    {
+        for(int y = Rules::FIRST_FOUNDATION; y < Rules::FIRST_TABLEAU; y++)
+        {
+            if(!last(y)->getPH() && last(y)->getSuit() == suit)
+            {
+                return last(y)->getIVal();
+            }
+        }
+        return 0;
+    }
+
+    // Returns true if moving card to the foundation can never make the game harder to win
+    // Aces and twos are always safe, other cards are safe once both suits of the other color
+    // reach one rank below the card, since nothing left could need the card to build on
+    bool isSafeToFoundation(Card * card)
+    {
+        if(card->getIVal() <= 2)
+        {
+            return true;
+        }
+        const char * othersuits = card->getColor() == 'r' ? "cs" : "dh";
+        return foundationRank(othersuits[0]) >= card->getIVal() - 1 &&
+            foundationRank(othersuits[1]) >= card->getIVal() - 1;
+    }
+
+    // Moves the last card of the discard (y = 0) or a tableau pile to the foundation
+    // Returns true if the card was moved, only safe moves are made if safeonly is true
+    // The move is added to played if it is not nullptr
+    bool toFoundation(int y, bool safeonly, std::vector<Move> * played = nullptr)
+    {
+        Card * card = last(y);
+        int x;
+        if(Rules::kind(y) == discardpile)
+        {
+            x = drawnColumn();
+            if(x < 0)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if(card->getPH())
+            {
+                return false;
+            }
+            for(x = Rules::capacity(y) - 1; GB[y][x]->getPH(); x--);
+        }
+        if(safeonly && !isSafeToFoundation(card))
+        {
+            return false;
+        }
+        for(int f = Rules::FIRST_FOUNDATION; f < Rules::FIRST_TABLEAU; f++)
+        {
+            if(moveCard(y, x, f))
+            {
+                boardRefresh();
+                if(played != nullptr)
+                {
+                    Move move;
+                    move.boardy = y;
+                    move.boardx = x;
+                    move.pileindex = f;
+                    played->push_back(move);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves up to maxmoves cards to the foundation, only safe moves if safeonly is true
+    // Returns the number of cards moved, and adds the moves to played if it is not nullptr
+    int autoPlay(bool safeonly, int maxmoves, std::vector<Move> * played = nullptr)
+    {
+        int moved = 0;
+        bool progress = true;
+        while(progress && moved < maxmoves)
+        {
+            progress = false;
+            for(int y = 0; y < Rules::PILES && moved < maxmoves; y++)
+            {
+                if(Rules::kind(y) != foundationpile && toFoundation(y, safeonly, played))
+                {
+                    moved++;
+                    progress = true;
+                }
+            }
+        }
+        return moved;
+    }
+
+    // Returns true if the game is won by moving cards to the foundation and drawing
+    // This is the case once every tableau card is face up and either the discard is empty or
+    // every card can be drawn in turn, since the lowest card left is then always playable
+    bool canAutoComplete()
+    {
+        for(int y = Rules::FIRST_TABLEAU; y < Rules::PILES; y++)
+        {
+            for(int x = 0; x < Rules::capacity(y) && !GB[y][x]->getPH(); x++)
+            {
+                if(!GB[y][x]->getRevealed())
+                {
+                    return false;
+                }
+            }
+        }
+        return drawtype == 1 || GB[Rules::DISCARD][0]->getPH();
+    }
+
+    // Moves up to maxmoves cards to the foundation in a game where canAutoComplete is true,
+    // drawing when nothing can be moved, returns the number of cards moved
+    // The moves and draws are added to played if it is not nullptr
+    int autoComplete(int maxmoves, std::vector<Move> * played = nullptr)
+    {
+        int moved = 0;
+        int draws = 0;
+        while(moved < maxmoves && !isWon() && draws <= 2 * Rules::DISCARD_CARDS)
+        {
+            int count = autoPlay(false, maxmoves - moved, played);
+            if(count > 0)
+            {
+                moved += count;
+                draws = 0;
+            }
+            else
+            {
+                Move move;
+                move.boardy = -1;
+                move.boardx = 0;
+                move.pileindex = 0;
+                applyMove(move);
+                if(played != nullptr)
+                {
+                    played->push_back(move);
+                }
+                draws++;
+            }
+        }
+        return moved;
+    }
+
+    // Deallocates all pointers
+    void deallocate()
+    {
+        delete PH;
+
+        for(int i = 0; i < Rules::CARDS; i++)
+        {
+            delete allcards[i];
+        }
+        delete[] allcards;
+
+        for(int i = 0; i < Rules::PILES; i++)
+        {
+            delete[] GB[i];
+        }
+        delete[] GB;
+    }
+    
+    // Draws 1 or 3 cards as the rules turn them over
+    void draw()
+    {
+        TRACE_SPAN("draw");
+        if(!Rules::draw(drawncards, maxdraw, drawtype)) // Put all cards back in the deck
+        {
+            undraw();
+        }
+    }
+
+    // Lays out the board into a grid, with the card cursor at boardy, boardx and, if
+    // pilesel, the pile cursor on pileindex
+    // The board is not refreshed first, so call boardRefresh after changing it directly
+    void layout(Screen & screen, int boardy, int boardx, bool pilesel, int pileindex)
+    {
+        // Lay out discard, the last drawn cards
+        layoutRow(screen, Rules::DISCARD, pilesel && Rules::kind(pileindex) == discardpile, 0);
+        Card * discardprint[Rules::SHOWN_DRAWN];
+        for(int i = Rules::DISCARD_CARDS - 1, count = Rules::SHOWN_DRAWN - 1; i >= 0 && count >= 0; i--)
+        {
+            if(drawncards[i] || i < Rules::SHOWN_DRAWN)
+            {
+                if(drawncards[i])
+                {
+                    discardprint[count--] = GB[Rules::DISCARD][i];
+                }
+                else
+                {
+                    discardprint[count--] = PH;
+                }
+            }
+        }
+        for(int i = 0; i < Rules::SHOWN_DRAWN; i++)
+        {
+            screen.put(Rules::DISCARD, 4 + 4 * i, discardprint[i]->getCVal(), discardprint[i]->getSuit(), pairOf(discardprint[i], boardx == i && boardy == Rules::DISCARD));
+        }
+        if(boardy == Rules::DISCARD && boardx >= Rules::SHOWN_DRAWN && boardx < Rules::COLUMNS)
+        {
+            screen.put(Rules::DISCARD, 4 + 4 * boardx, ' ', ' ', 3);
+        }
+
+        // Lay out foundation, the last card of each pile
+        // Placeholders lay out as the empty slot already in the row, so only the cursor's
+        // placeholder is put in the grid
+        for(int i = Rules::FIRST_FOUNDATION; i < Rules::FIRST_TABLEAU; i++)
+        {
+            layoutRow(screen, i, pilesel, pileindex);
+            Card * printcard = last(i);
+            if(printcard->getRevealed())
+            {
+                screen.put(i, 4, printcard->getCVal(), printcard->getSuit(), pairOf(printcard, boardx == 0 && i == boardy));
+            }
+            if(i == boardy && boardx > 0 && boardx < Rules::COLUMNS)
+            {
+                screen.put(i, 4 + 4 * boardx, ' ', ' ', 3);
+            }
+        }
+
+        // Lay out tableau
+        for(int i = Rules::FIRST_TABLEAU; i < Rules::PILES; i++)
+        {
+            layoutRow(screen, i, pilesel, pileindex);
+            for(int n = 0; n < Rules::COLUMNS; n++)
+            {
+                Card * printcard = n > Rules::capacity(i) - 1 ? PH : GB[i][n];
+                bool selected = n == boardx && i == boardy;
+                if(printcard->getPH() && !selected)
+                {
+                    continue;
+                }
+                int pair = pairOf(printcard, selected);
+                if(printcard->getRevealed())
+                {
+                    screen.put(i, 4 + 4 * n, printcard->getCVal(), printcard->getSuit(), pair);
+                }
+                else
+                {
+                    screen.put(i, 4 + 4 * n, '-', '-', pair);
+                }
+            }
+        }
+    }
+
+    // Prints all items in the gameboard
+    void printGB(int boardy, int boardx, bool pilesel, int pileindex)
+    {
+        TRACE_SPAN("printGB");
+        boardRefresh();
+        Screen screen;
+        layout(screen, boardy, boardx, pilesel, pileindex);
+        drawScreen(screen);
+    }
+};
+
+typedef BasicGameBoard<KlondikeRules> GameBoard;
+
+static const int STATE_SIZE = GameBoard::STATE_BYTES;   // Bytes written by saveState
+static const int STATE_CARDS = KlondikeRules::SLOTS;     // Card slot bytes at the start of a state
+
+#endif
@@ -0,0 +1,130 @@
+// Reports on the games in a game store
+// Usage: gamesquery [file] [from date] [to date]
+// Build: clang++ -std=gnu++11 -lncurses gamesquery.cpp -o gamesquery
+//
+// Prints the games, win rate, mean moves and mean duration for each player and draw type,
+// for games that finished between the dates (YYYY-MM-DD, both included, in UTC). Segments
+// entirely inside the range are counted from their summaries, and only the segments that
+// straddle an end of the range have their time, outcome, draw type, move count and
+// duration columns read. Move streams are never read.
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include "gamestore.h"
+
+// Totals of the games of one player and draw type
+// A segment's summary counts its games in 32 bits, which a sum over a whole store can overflow
+typedef struct
+{
+    uint64_t games;
+    uint64_t wins;
+    uint64_t losses;
+    uint64_t suspended;
+    uint64_t moves;
+    uint64_t duration;
+} QueryTotals;
+
+// Parses a YYYY-MM-DD date into the Unix time at its start, returns false if it is not one
+bool parseDate(const char * text, int64_t & time)
+{
+    struct tm date;
+    memset(&date, 0, sizeof(date));
+    const char * end = strptime(text, "%Y-%m-%d", &date);
+    if(end == nullptr || *end != '\0')
+    {
+        return false;
+    }
+    time = timegm(&date);
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    const char * path = argc > 1 ? argv[1] : "games.db";
+    int64_t from = INT64_MIN;
+    int64_t to = INT64_MAX;
+    if((argc > 2 && !parseDate(argv[2], from)) || (argc > 3 && !parseDate(argv[3], to)))
+    {
+        printf("Usage: %s [file] [from YYYY-MM-DD] [to YYYY-MM-DD]\n", argv[0]);
+        return 1;
+    }
+    if(argc > 3)
+    {
+        to += 24 * 60 * 60 - 1;
+    }
+
+    GameStoreReader store;
+    if(!store.open(path))
+    {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+
+    // Totals by player, then by draw type
+    std::map<std::string, QueryTotals[2]> totals;
+    size_t summarized = 0;
+    size_t scanned = 0;
+    for(size_t s = 0; s < store.segmentCount(); s++)
+    {
+        const GameSegmentHeader * header = store.segment(s);
+        if(header->last < from || header->first > to)
+        {
+            continue;
+        }
+        QueryTotals * total = totals[std::string(header->player, strnlen(header->player, sizeof(header->player)))];
+        if(header->first >= from && header->last <= to)
+        {
+            for(int d = 0; d < 2; d++)
+            {
+                total[d].games += header->summary[d].games;
+                total[d].wins += header->summary[d].wins;
+                total[d].losses += header->summary[d].losses;
+                total[d].suspended += header->summary[d].suspended;
+                total[d].moves += header->summary[d].moves;
+                total[d].duration += header->summary[d].duration;
+            }
+            summarized++;
+            continue;
+        }
+        GameColumns columns = store.columns(s);
+        for(uint32_t g = 0; g < header->count; g++)
+        {
+            int64_t finished = header->first + columns.finished[g];
+            if(finished < from || finished > to)
+            {
+                continue;
+            }
+            QueryTotals & summary = total[columns.drawtypes[g] == 1 ? 0 : 1];
+            summary.games++;
+            summary.wins += columns.outcomes[g] == gamewon;
+            summary.losses += columns.outcomes[g] == gamelost;
+            summary.suspended += columns.outcomes[g] == gamesuspended;
+            summary.moves += columns.movecounts[g];
+            summary.duration += columns.durations[g];
+        }
+        scanned++;
+    }
+
+    printf("%zu segments, %zu from summaries, %zu scanned\n", store.segmentCount(), summarized, scanned);
+    printf("%-16s %4s %10s %9s %9s %11s %12s\n", "player", "draw", "games", "win rate", "suspended", "mean moves", "mean seconds");
+    for(std::map<std::string, QueryTotals[2]>::iterator it = totals.begin(); it != totals.end(); ++it)
+    {
+        for(int d = 0; d < 2; d++)
+        {
+            const QueryTotals & summary = it->second[d];
+            if(summary.games == 0)
+            {
+                continue;
+            }
+            uint64_t finished = summary.wins + summary.losses;
+            printf("%-16s %4d %10" PRIu64 " %8.1f%% %9" PRIu64 " %11.1f %12.1f\n", it->first.c_str(), d == 0 ? 1 : 3, summary.games,
+                finished > 0 ? 100.0 * summary.wins / finished : 0.0, summary.suspended,
+                (double) summary.moves / summary.games, summary.duration / 1000.0 / summary.games);
+        }
+    }
+    return 0;
+}
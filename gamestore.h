@@ -0,0 +1,446 @@
+#ifndef GAMESTORE_H
+#define GAMESTORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "gameboard.h"
+
+static const char GAMESTORE_MAGIC[8] = {'S', 'O', 'L', 'G', 'A', 'M', 'E', 'S'};
+static const uint32_t GAMESTORE_VERSION = 1;
+static const size_t GAMESTORE_SEGMENT = 4096; // Games a writer buffers before appending a segment
+
+// How a stored game ended
+enum GameOutcome
+{
+    gamelost,     // Lost, or given up by the player or an agent
+    gamewon,      // Every card reached the foundation
+    gamesuspended // Saved to resume later, only in stores from before the front end stored
+                  // games once they ended, when each session of a game was its own row
+};
+
+// Totals for the games of one draw type in a segment
+typedef struct
+{
+    uint32_t games;     // Games stored
+    uint32_t wins;      // Games with outcome gamewon
+    uint32_t losses;    // Games with outcome gamelost
+    uint32_t suspended; // Games with outcome gamesuspended
+    uint64_t moves;     // Sum of the move counts
+    uint64_t duration;  // Sum of the durations in milliseconds
+} GameSummary;
+
+// Header at the start of each segment of a game store
+// A store is a sequence of segments that is only ever appended to. Each segment holds the
+// games of one writer in columns, so a query reads only the columns it needs, and its
+// summaries answer queries about whole segments without reading the columns at all
+// The header is followed by count values of each column in this order:
+//   uint32_t seed, uint32_t finished (seconds after first), uint32_t duration (milliseconds),
+//   uint32_t move count, uint32_t end of the game's moves in the move stream,
+//   uint8_t draw type, uint8_t outcome (a GameOutcome)
+// then the move stream, written by encodeMoves, and zeros up to a multiple of 8 bytes
+typedef struct
+{
+    char magic[8];          // Always GAMESTORE_MAGIC
+    uint32_t version;       // Always GAMESTORE_VERSION
+    uint32_t length;        // Bytes in the segment, including the header
+    uint32_t count;         // Games in the segment
+    uint32_t movebytes;     // Bytes in the move stream
+    char player[16];        // Who played the games, "human" for the front end
+    int64_t first;          // Unix time the earliest game finished
+    int64_t last;           // Unix time the latest game finished
+    GameSummary summary[2]; // Totals for draw 1 and draw 3
+} GameSegmentHeader;
+
+// The columns of one segment
+typedef struct
+{
+    const GameSegmentHeader * header;
+    const uint32_t * seeds;
+    const uint32_t * finished;
+    const uint32_t * durations;
+    const uint32_t * movecounts;
+    const uint32_t * moveends;
+    const uint8_t * drawtypes;
+    const uint8_t * outcomes;
+    const uint8_t * moves;
+} GameColumns;
+
+// Returns the bytes of a segment of count games with movebytes bytes of moves
+inline size_t segmentLength(size_t count, size_t movebytes)
+{
+    size_t length = sizeof(GameSegmentHeader) + count * (5 * sizeof(uint32_t) + 2) + movebytes;
+    return (length + 7) & ~(size_t) 7;
+}
+
+// Returns true if header starts a complete segment at offset in a file of filelen bytes
+inline bool validSegment(const GameSegmentHeader * header, size_t offset, size_t filelen)
+{
+    return
+        memcmp(header->magic, GAMESTORE_MAGIC, 8) == 0 &&
+        header->version == GAMESTORE_VERSION &&
+        header->length == segmentLength(header->count, header->movebytes) &&
+        offset + header->length <= filelen;
+}
+
+// Returns true if the move ends of a segment's count games never go back and stay inside
+// its movebytes bytes of moves, so every game's moves can be read from the move stream
+inline bool validMoveEnds(const uint32_t * moveends, uint32_t count, uint32_t movebytes)
+{
+    for(uint32_t g = 1; g < count; g++)
+    {
+        if(moveends[g] < moveends[g - 1])
+        {
+            return false;
+        }
+    }
+    return count == 0 || moveends[count - 1] <= movebytes;
+}
+
+// Appends moves that were applied to a board to out, using 1 or 2 bytes for each move
+// A run of up to 16 draws is one byte, 0 to 15 for the length of the run less 1. Other
+// moves are one byte, (boardy + 1) << 4 | pileindex, followed by boardx for moves from the
+// discard or tableau. Foundation moves always have a boardx of 0, so it is left out
+inline void encodeMoves(const std::vector<Move> & moves, std::vector<uint8_t> & out)
+{
+    for(size_t i = 0; i < moves.size();)
+    {
+        if(moves[i].boardy == -1)
+        {
+            size_t run = 1;
+            while(run < 16 && i + run < moves.size() && moves[i + run].boardy == -1)
+            {
+                run++;
+            }
+            out.push_back(run - 1);
+            i += run;
+            continue;
+        }
+        out.push_back((moves[i].boardy + 1) << 4 | moves[i].pileindex);
+        if(moves[i].boardy == 0 || moves[i].boardy > 4)
+        {
+            out.push_back(moves[i].boardx);
+        }
+        i++;
+    }
+}
+
+// Decodes len bytes written by encodeMoves into moves
+inline void decodeMoves(const uint8_t * data, size_t len, std::vector<Move> & moves)
+{
+    moves.clear();
+    for(size_t i = 0; i < len; i++)
+    {
+        Move move;
+        move.boardy = (data[i] >> 4) - 1;
+        move.boardx = 0;
+        move.pileindex = 0;
+        if(move.boardy == -1)
+        {
+            moves.insert(moves.end(), (data[i] & 15) + 1, move);
+            continue;
+        }
+        move.pileindex = data[i] & 15;
+        if((move.boardy == 0 || move.boardy > 4) && i + 1 < len)
+        {
+            move.boardx = data[++i];
+        }
+        moves.push_back(move);
+    }
+}
+
+// Writes games to a store, a segment at a time
+// Games are buffered and appended as one segment every GAMESTORE_SEGMENT games and when
+// the writer is flushed or destroyed. Appends take an exclusive lock on the file, so any
+// number of writers in any number of processes can share a store
+// A segment torn by a crash during an append, or one the reader would stop at, is cut off
+// by the next append, so the games after it are not lost behind it
+class GameStore
+{
+private:
+    std::string path;
+    char player[16];
+    std::vector<uint32_t> seeds;
+    std::vector<int64_t> finished;
+    std::vector<uint32_t> durations;
+    std::vector<uint32_t> movecounts;
+    std::vector<uint32_t> moveends;
+    std::vector<uint8_t> drawtypes;
+    std::vector<uint8_t> outcomes;
+    std::vector<uint8_t> moves;
+
+    // Cuts the file off after its last complete segment, returns false if it could not
+    // The caller holds the exclusive lock, so no other writer is appending
+    static bool truncateTorn(int fd)
+    {
+        struct stat st;
+        if(fstat(fd, &st) != 0)
+        {
+            return false;
+        }
+        size_t filelen = st.st_size;
+        size_t offset = 0;
+        GameSegmentHeader header;
+        std::vector<uint32_t> moveends;
+        while
+        (
+            offset + sizeof(header) <= filelen &&
+            pread(fd, &header, sizeof(header), offset) == (ssize_t) sizeof(header) &&
+            validSegment(&header, offset, filelen)
+        )
+        {
+            // The move ends are the fifth column
+            moveends.resize(header.count);
+            size_t len = header.count * sizeof(uint32_t);
+            if
+            (
+                pread(fd, moveends.data(), len, offset + sizeof(header) + 4 * len) != (ssize_t) len ||
+                !validMoveEnds(moveends.data(), header.count, header.movebytes)
+            )
+            {
+                break;
+            }
+            offset += header.length;
+        }
+        return offset == filelen || ftruncate(fd, offset) == 0;
+    }
+public:
+    // Writes to the store at p, creating it if needed, with who played the games
+    GameStore(const char * p, const char * who)
+    {
+        path = p;
+        memset(player, 0, sizeof(player));
+        strncpy(player, who, sizeof(player) - 1);
+    }
+
+    ~GameStore()
+    {
+        flush();
+    }
+
+    // Adds a game that finished at Unix time end after duration milliseconds of play
+    // played is every move applied to the board, in order
+    void add(uint32_t seed, int drawtype, GameOutcome outcome, int64_t end, uint32_t duration, const std::vector<Move> & played)
+    {
+        seeds.push_back(seed);
+        finished.push_back(end);
+        durations.push_back(duration);
+        movecounts.push_back(played.size());
+        encodeMoves(played, moves);
+        moveends.push_back(moves.size());
+        drawtypes.push_back(drawtype);
+        outcomes.push_back(outcome);
+        if(seeds.size() >= GAMESTORE_SEGMENT)
+        {
+            flush();
+        }
+    }
+
+    // Appends the buffered games as a segment, returns false if they could not be written
+    // and are still buffered
+    bool flush()
+    {
+        size_t count = seeds.size();
+        if(count == 0)
+        {
+            return true;
+        }
+        std::vector<uint8_t> data(segmentLength(count, moves.size()), 0);
+        GameSegmentHeader * header = (GameSegmentHeader *) data.data();
+        memcpy(header->magic, GAMESTORE_MAGIC, 8);
+        header->version = GAMESTORE_VERSION;
+        header->length = data.size();
+        header->count = count;
+        header->movebytes = moves.size();
+        memcpy(header->player, player, sizeof(player));
+        header->first = finished[0];
+        header->last = finished[0];
+        for(size_t i = 0; i < count; i++)
+        {
+            header->first = finished[i] < header->first ? finished[i] : header->first;
+            header->last = finished[i] > header->last ? finished[i] : header->last;
+            GameSummary & summary = header->summary[drawtypes[i] == 1 ? 0 : 1];
+            summary.games++;
+            summary.wins += outcomes[i] == gamewon;
+            summary.losses += outcomes[i] == gamelost;
+            summary.suspended += outcomes[i] == gamesuspended;
+            summary.moves += movecounts[i];
+            summary.duration += durations[i];
+        }
+
+        uint8_t * out = (uint8_t *) (header + 1);
+        uint32_t * column = (uint32_t *) out;
+        memcpy(column, seeds.data(), count * sizeof(uint32_t));
+        column += count;
+        for(size_t i = 0; i < count; i++)
+        {
+            column[i] = finished[i] - header->first;
+        }
+        column += count;
+        memcpy(column, durations.data(), count * sizeof(uint32_t));
+        column += count;
+        memcpy(column, movecounts.data(), count * sizeof(uint32_t));
+        column += count;
+        memcpy(column, moveends.data(), count * sizeof(uint32_t));
+        column += count;
+        out = (uint8_t *) column;
+        memcpy(out, drawtypes.data(), count);
+        out += count;
+        memcpy(out, outcomes.data(), count);
+        out += count;
+        memcpy(out, moves.data(), moves.size());
+
+        // The whole segment goes in one write, so readers and other writers see all of it
+        // or, after a crash, a torn tail that readers skip and the next append cuts off
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if(fd < 0)
+        {
+            return false;
+        }
+        flock(fd, LOCK_EX);
+        bool ok = truncateTorn(fd);
+        ok = ok && ::write(fd, data.data(), data.size()) == (ssize_t) data.size();
+        ok = fdatasync(fd) == 0 && ok;
+        flock(fd, LOCK_UN);
+        ::close(fd);
+        if(!ok)
+        {
+            return false;
+        }
+        seeds.clear();
+        finished.clear();
+        durations.clear();
+        movecounts.clear();
+        moveends.clear();
+        drawtypes.clear();
+        outcomes.clear();
+        moves.clear();
+        return true;
+    }
+};
+
+// Read-only, memory-mapped game store
+// Segments appended after the store is opened are not seen until it is opened again
+class GameStoreReader
+{
+private:
+    void * map = nullptr;                           // Mapped file
+    size_t maplen = 0;                              // Length of the mapped file
+    std::vector<const GameSegmentHeader *> segments; // Every complete segment in the file
+public:
+    ~GameStoreReader()
+    {
+        close();
+    }
+
+    // Maps a store and finds its segments, returns false if it cannot be read
+    // A segment that is cut short or not valid, including one whose move ends would read
+    // outside its move stream, ends the store, so a torn append is ignored
+    // until a writer cuts it off. The file is locked while its segments are found, so that
+    // cannot happen under the reader
+    bool open(const char * path)
+    {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0)
+        {
+            return false;
+        }
+        flock(fd, LOCK_SH);
+        struct stat st;
+        if(fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        maplen = st.st_size;
+        if(maplen == 0)
+        {
+            ::close(fd);
+            return true;
+        }
+        map = mmap(nullptr, maplen, PROT_READ, MAP_SHARED, fd, 0);
+        if(map == MAP_FAILED)
+        {
+            ::close(fd);
+            map = nullptr;
+            return false;
+        }
+
+        for(size_t offset = 0; offset + sizeof(GameSegmentHeader) <= maplen;)
+        {
+            const GameSegmentHeader * header = (const GameSegmentHeader *) ((const uint8_t *) map + offset);
+            // The move ends are the fifth column
+            if
+            (
+                !validSegment(header, offset, maplen) ||
+                !validMoveEnds((const uint32_t *) (header + 1) + 4 * header->count, header->count, header->movebytes)
+            )
+            {
+                break;
+            }
+            segments.push_back(header);
+            offset += header->length;
+        }
+        ::close(fd); // Closing releases the lock
+        return true;
+    }
+
+    // Unmaps the file if one is open
+    void close()
+    {
+        if(map != nullptr)
+        {
+            munmap(map, maplen);
+        }
+        map = nullptr;
+        maplen = 0;
+        segments.clear();
+    }
+
+    // Returns the number of segments in the store
+    size_t segmentCount()
+    {
+        return segments.size();
+    }
+
+    // Returns the header of segment i, which holds its summaries
+    const GameSegmentHeader * segment(size_t i)
+    {
+        return segments[i];
+    }
+
+    // Returns the columns of segment i
+    GameColumns columns(size_t i)
+    {
+        GameColumns columns;
+        uint32_t count = segments[i]->count;
+        columns.header = segments[i];
+        columns.seeds = (const uint32_t *) (segments[i] + 1);
+        columns.finished = columns.seeds + count;
+        columns.durations = columns.finished + count;
+        columns.movecounts = columns.durations + count;
+        columns.moveends = columns.movecounts + count;
+        columns.drawtypes = (const uint8_t *) (columns.moveends + count);
+        columns.outcomes = columns.drawtypes + count;
+        columns.moves = columns.outcomes + count;
+        return columns;
+    }
+
+    // Decodes the moves of game g of segment i
+    void moves(size_t i, uint32_t g, std::vector<Move> & played)
+    {
+        GameColumns c = columns(i);
+        uint32_t start = g == 0 ? 0 : c.moveends[g - 1];
+        decodeMoves(c.moves + start, c.moveends[g] - start, played);
+    }
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <vector>
+#include "gameboard.h"
+
+// Record of every move and draw in a game that can seek to any point in it
+// A saved board state is kept every interval moves, so seeking to move m loads the
+// checkpoint at or before m and replays fewer than interval moves
+template <typename Rules>
+class BasicHistory
+{
+private:
+    typedef BasicGameBoard<Rules> Board;
+
+    int interval;                     // Moves between checkpoints
+    int position = 0;                 // Number of moves applied to the board
+    std::vector<Move> moves;          // Every move recorded, including undone ones after position
+    std::vector<unsigned char> saves; // Checkpoint n is STATE_BYTES bytes at n * STATE_BYTES
+public:
+    // Starts a history at the current state of board
+    BasicHistory(Board * board, int k)
+    {
+        interval = k;
+        saves.resize(Board::STATE_BYTES);
+        board->saveState(saves.data());
+    }
+
+    // Restores a history from the moves and checkpoints of another one
+    BasicHistory(int k, int pos, const std::vector<Move> & recorded, const unsigned char * checkpoints, int checkpointcount)
+    {
+        interval = k;
+        position = pos;
+        moves = recorded;
+        saves.assign(checkpoints, checkpoints + checkpointcount * Board::STATE_BYTES);
+    }
+
+    // Records a move that was just applied to board with GameBoard::applyMove
+    // Any moves after the current position are forgotten
+    void record(Board * board, Move move)
+    {
+        moves.resize(position);
+        saves.resize((position / interval + 1) * Board::STATE_BYTES);
+        moves.push_back(move);
+        position++;
+        if(position % interval == 0)
+        {
+            saves.resize(saves.size() + Board::STATE_BYTES);
+            board->saveState(saves.data() + saves.size() - Board::STATE_BYTES);
+        }
+    }
+
+    // Records moves that were just applied to board together, such as by GameBoard::autoPlay
+    // The board is rewound and the moves are applied again so checkpoints between them are saved
+    void record(Board * board, const std::vector<Move> & played)
+    {
+        seek(board, position);
+        for(size_t i = 0; i < played.size(); i++)
+        {
+            board->applyMove(played[i]);
+            record(board, played[i]);
+        }
+    }
+
+    // Puts board in the state after the first m moves, returns false if m is out of range
+    bool seek(Board * board, int m)
+    {
+        if(m < 0 || m > (int) moves.size())
+        {
+            return false;
+        }
+        int checkpoint = m / interval;
+        if((size_t) (checkpoint + 1) * Board::STATE_BYTES > saves.size())
+        {
+            checkpoint = saves.size() / Board::STATE_BYTES - 1;
+        }
+        // The first checkpoint is the deal before its first refresh, and the front end always
+        // refreshes the board before a move
+        board->loadState(saves.data() + checkpoint * Board::STATE_BYTES);
+        board->boardRefresh();
+        for(int i = checkpoint * interval; i < m; i++)
+        {
+            board->applyMove(moves[i]);
+        }
+        position = m;
+        return true;
+    }
+
+    // Returns the number of moves applied to the board
+    int getPosition()
+    {
+        return position;
+    }
+
+    // Returns the number of moves recorded, including ones after the current position
+    int length()
+    {
+        return moves.size();
+    }
+
+    // Returns the moves recorded
+    const std::vector<Move> & getMoves()
+    {
+        return moves;
+    }
+
+    // Returns the number of moves between checkpoints
+    int getInterval()
+    {
+        return interval;
+    }
+
+    // Returns the number of checkpoints
+    int checkpointCount()
+    {
+        return saves.size() / Board::STATE_BYTES;
+    }
+
+    // Returns the checkpoints, STATE_BYTES bytes each
+    const unsigned char * getCheckpoints()
+    {
+        return saves.data();
+    }
+};
+
+typedef BasicHistory<KlondikeRules> History;
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <ncurses.h>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+
+static const int ESCAPE_MS = 50; // Time after ESC before it is taken as a key on its own
+
+// Lock-free queue for one producer thread and one consumer thread
+// N must be a power of 2, and the queue holds at most N - 1 items
+template <typename T, size_t N>
+class SPSCQueue
+{
+private:
+    T items[N];
+    std::atomic<size_t> head; // Next index to pop, only written by the consumer
+    std::atomic<size_t> tail; // Next index to push, only written by the producer
+public:
+    SPSCQueue() : head(0), tail(0)
+    {
+    }
+
+    // Adds an item, returns false if the queue is full
+    bool push(T item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == N - 1)
+        {
+            return false;
+        }
+        items[t % N] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Removes the oldest item into item, returns false if the queue is empty
+    bool pop(T & item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = items[h % N];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// Reads keys from the terminal on its own thread into a queue
+// ncurses is not thread safe, so this reads stdin directly instead of calling getch and
+// decodes arrow keys into the same codes getch uses (KEY_UP and so on)
+// An ESC that does not start a sequence is delivered as key 27, once the next byte shows it
+// is not one or ESCAPE_MS pass without one
+// Both threads sleep until there is something to do: the reader in poll, woken by a key or
+// by stop writing to a pipe, and a waiting consumer on a condition variable
+class InputReader
+{
+private:
+    SPSCQueue<int, 256> keys;       // Keys read and not yet taken
+    std::atomic<bool> stopping;     // true when the thread should exit
+    std::thread reader;             // Thread running read()
+    int wake[2] = {-1, -1};         // Pipe that stop writes to so poll returns
+    std::mutex lock;                // Held while waiting for a key and to signal one
+    std::condition_variable pushed; // Signals a key was added to keys
+
+    // Adds a key and wakes the consumer if it is waiting
+    // The lock is taken after the push, so a consumer that found the queue empty is
+    // already waiting when the signal is sent
+    bool push(int key)
+    {
+        if(!keys.push(key))
+        {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+        }
+        pushed.notify_one();
+        return true;
+    }
+
+    // Adds a key, waiting while the queue is full
+    void deliver(int key)
+    {
+        while(!push(key) && !stopping.load())
+        {
+            usleep(1000);
+        }
+    }
+
+    // Reads and decodes keys until stopped
+    void read()
+    {
+        int escape = 0; // 1 after ESC, 2 after ESC [ or ESC O
+        struct pollfd fds[2];
+        fds[0].fd = STDIN_FILENO;
+        fds[0].events = POLLIN;
+        fds[1].fd = wake[0];
+        fds[1].events = POLLIN;
+        while(!stopping.load())
+        {
+            int ready = ::poll(fds, 2, escape == 1 ? ESCAPE_MS : wake[0] == -1 ? 50 : -1);
+            if(ready == 0 && escape == 1) // Nothing followed the ESC
+            {
+                escape = 0;
+                deliver(27);
+                continue;
+            }
+            if(ready <= 0 || (fds[0].revents & POLLIN) == 0)
+            {
+                continue;
+            }
+            unsigned char buf[64];
+            ssize_t len = ::read(STDIN_FILENO, buf, sizeof(buf));
+            for(ssize_t i = 0; i < len; i++)
+            {
+                int key = buf[i];
+                if(escape == 1)
+                {
+                    if(key == '[' || key == 'O')
+                    {
+                        escape = 2;
+                        continue;
+                    }
+                    // Not a sequence, so the ESC was a key and this byte is the next one
+                    escape = 0;
+                    deliver(27);
+                }
+                if(escape == 0 && key == 27)
+                {
+                    escape = 1;
+                    continue;
+                }
+                if(escape == 2)
+                {
+                    escape = 0;
+                    switch(key)
+                    {
+                        case 'A':
+                            key = KEY_UP;
+                            break;
+                        case 'B':
+                            key = KEY_DOWN;
+                            break;
+                        case 'C':
+                            key = KEY_RIGHT;
+                            break;
+                        case 'D':
+                            key = KEY_LEFT;
+                            break;
+                        default:
+                            continue;
+                    }
+                }
+                deliver(key);
+            }
+        }
+    }
+public:
+    InputReader() : stopping(false)
+    {
+        if(pipe(wake) != 0)
+        {
+            wake[0] = -1;
+            wake[1] = -1;
+        }
+    }
+
+    ~InputReader()
+    {
+        stop();
+        if(wake[0] != -1)
+        {
+            close(wake[0]);
+            close(wake[1]);
+        }
+    }
+
+    // Starts the reading thread
+    void start()
+    {
+        reader = std::thread(&InputReader::read, this);
+    }
+
+    // Stops and joins the reading thread
+    void stop()
+    {
+        stopping.store(true);
+        if(wake[1] != -1 && reader.joinable())
+        {
+            char byte = 0;
+            while(::write(wake[1], &byte, 1) < 0 && errno == EINTR);
+        }
+        if(reader.joinable())
+        {
+            reader.join();
+        }
+    }
+
+    // Takes the oldest key into key, returns false if there is none
+    bool take(int & key)
+    {
+        return keys.pop(key);
+    }
+
+    // Takes the oldest key, waiting for one if there is none
+    int wait()
+    {
+        int key;
+        std::unique_lock<std::mutex> guard(lock);
+        pushed.wait(guard, [&]() { return keys.pop(key); });
+        return key;
+    }
+
+    // Takes the oldest key into key, waiting up to ms milliseconds for one if there is none,
+    // returns false if none arrived
+    bool waitFor(int & key, int ms)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        return pushed.wait_for(guard, std::chrono::milliseconds(ms), [&]() { return keys.pop(key); });
+    }
+};
+
+#endif
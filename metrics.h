@@ -0,0 +1,231 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// Live counters published in shared memory so a running process can be watched with
+// metricsview without stopping it
+// A program calls metricsPublish("name") once at start to create /dev/shm/soli.<name>.<pid>
+// and metricsUnpublish() before exiting, until then counts go to a private block
+//
+// Counting takes no lock: each thread adds to its own pending counts and flushes them into
+// the block with relaxed atomic adds every METRICS_BATCH counts, so threads rarely touch the
+// shared cache line. Threads that finish should call metricsFlush() so their last counts
+// are not lost, and the front end flushes every frame
+//
+// Allocations are counted by replacing the global operator new, which is done in the
+// translation unit that defines SOLI_METRICS_MAIN before including this file
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const char METRICS_MAGIC[8] = {'S', 'O', 'L', 'I', 'M', 'E', 'T', 'R'};
+static const uint32_t METRICS_VERSION = 1;
+static const int METRICS_BATCH = 1024; // Counts a thread keeps before flushing them
+
+// Counters in a metrics block, new ones are only ever added at the end
+enum Metric
+{
+    gamesplayed,      // Games started by the front end or played by batch tools
+    movesapplied,     // Moves and draws applied to any board
+    solvernodes,      // Boards expanded by solvers
+    solversearches,   // Solver searches finished
+    solvernanos,      // Nanoseconds spent in solver searches
+    ttprobes,         // Lookups in the solvers' tables of searched positions
+    tthits,           // Lookups that found the position already searched
+    framesdrawn,      // Frames drawn by the front end
+    framenanos,       // Nanoseconds spent drawing frames
+    allocations,      // Calls to operator new
+    METRIC_COUNT
+};
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "Metrics need lock free 64 bit atomics to be shared between processes"
+#endif
+
+// Layout of the shared memory segment, which never changes within a METRICS_VERSION
+typedef struct
+{
+    char magic[8];                              // Always METRICS_MAGIC
+    uint32_t version;                           // Always METRICS_VERSION
+    uint32_t pid;                               // Process that publishes the block
+    char program[16];                           // Name given to metricsPublish
+    int64_t started;                            // Unix time in nanoseconds when published
+    uint64_t pad[3];
+    std::atomic<uint64_t> counters[METRIC_COUNT]; // Indexed by Metric
+    std::atomic<uint64_t> framemax;             // Nanoseconds taken by the slowest frame
+} MetricsBlock;
+
+// Returns the block counts are flushed into
+inline std::atomic<MetricsBlock *> & metricsBlock()
+{
+    static MetricsBlock local;
+    static std::atomic<MetricsBlock *> block(&local);
+    return block;
+}
+
+// Counts not yet flushed by the calling thread
+// Kept trivially destructible so counting never allocates, even from operator new
+typedef struct
+{
+    uint64_t counts[METRIC_COUNT];
+    int pending;
+} MetricsPending;
+
+inline MetricsPending & metricsPending()
+{
+    static thread_local MetricsPending pending;
+    return pending;
+}
+
+// Adds the calling thread's pending counts to the block
+inline void metricsFlush()
+{
+    MetricsPending & pending = metricsPending();
+    MetricsBlock * block = metricsBlock().load(std::memory_order_acquire);
+    for(int i = 0; i < METRIC_COUNT; i++)
+    {
+        if(pending.counts[i] != 0)
+        {
+            block->counters[i].fetch_add(pending.counts[i], std::memory_order_relaxed);
+            pending.counts[i] = 0;
+        }
+    }
+    pending.pending = 0;
+}
+
+// Adds n to a counter
+inline void metricsCount(Metric metric, uint64_t n = 1)
+{
+    MetricsPending & pending = metricsPending();
+    pending.counts[metric] += n;
+    if(++pending.pending >= METRICS_BATCH)
+    {
+        metricsFlush();
+    }
+}
+
+// Counts a frame that took nanos nanoseconds to draw and flushes, since frames are rare
+inline void metricsFrame(uint64_t nanos)
+{
+    metricsCount(framesdrawn);
+    metricsCount(framenanos, nanos);
+    metricsFlush();
+    std::atomic<uint64_t> & framemax = metricsBlock().load(std::memory_order_acquire)->framemax;
+    uint64_t slowest = framemax.load(std::memory_order_relaxed);
+    while(nanos > slowest && !framemax.compare_exchange_weak(slowest, nanos, std::memory_order_relaxed));
+}
+
+// Writes the path of the segment of a process into buf
+inline void metricsPath(const char * program, int pid, char * buf, size_t len)
+{
+    snprintf(buf, len, "/dev/shm/soli.%s.%d", program, pid);
+}
+
+// Creates the shared memory segment and moves the counts made so far into it
+// Returns false and keeps counting privately if the segment cannot be created
+inline bool metricsPublish(const char * program)
+{
+    char path[64];
+    metricsPath(program, getpid(), path, sizeof(path));
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        return false;
+    }
+    if(ftruncate(fd, sizeof(MetricsBlock)) != 0)
+    {
+        close(fd);
+        unlink(path);
+        return false;
+    }
+    void * map = mmap(nullptr, sizeof(MetricsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        unlink(path);
+        return false;
+    }
+
+    // The file is zero filled, so the counters start at 0
+    MetricsBlock * block = (MetricsBlock *) map;
+    MetricsBlock * local = metricsBlock().load();
+    block->version = METRICS_VERSION;
+    block->pid = getpid();
+    strncpy(block->program, program, sizeof(block->program) - 1);
+    block->started = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    for(int i = 0; i < METRIC_COUNT; i++)
+    {
+        block->counters[i].store(local->counters[i].load());
+    }
+    block->framemax.store(local->framemax.load());
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(block->magic, METRICS_MAGIC, 8);
+    metricsBlock().store(block, std::memory_order_release);
+    return true;
+}
+
+// Removes the shared memory segment, should be called once the counting threads have stopped
+inline void metricsUnpublish()
+{
+    MetricsBlock * block = metricsBlock().load();
+    if(memcmp(block->magic, METRICS_MAGIC, 8) != 0)
+    {
+        return;
+    }
+    char path[64];
+    metricsPath(block->program, block->pid, path, sizeof(path));
+    unlink(path);
+}
+
+#ifdef SOLI_METRICS_MAIN
+// The replacements are not inlined so the compiler does not pair free with operator new
+inline void * metricsAllocate(size_t size)
+{
+    metricsCount(allocations);
+    void * p = malloc(size == 0 ? 1 : size);
+    if(p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void * operator new(size_t size)
+{
+    return metricsAllocate(size);
+}
+
+__attribute__((noinline)) void * operator new[](size_t size)
+{
+    return metricsAllocate(size);
+}
+
+__attribute__((noinline)) void operator delete(void * p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void * p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void * p, size_t size) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void * p, size_t size) noexcept
+{
+    free(p);
+}
+#endif
+
+#endif
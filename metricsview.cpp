@@ -0,0 +1,160 @@
+// Samples the live metrics of every running program that publishes them
+// Usage: metricsview [interval ms] [samples]
+// Build: clang++ -std=gnu++11 metricsview.cpp -o metricsview
+//
+// Every interval, prints one line per process with the rates over the interval and the
+// totals since it started. samples is the number of intervals to print, 0 to run until
+// interrupted
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+#include "metrics.h"
+
+// A mapped segment and its counters at the last sample
+typedef struct
+{
+    std::string path;
+    const MetricsBlock * block;
+    uint64_t last[METRIC_COUNT];
+} Segment;
+
+// Maps a segment read-only, returns nullptr if it is not a valid metrics block
+const MetricsBlock * mapSegment(const char * path)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size != sizeof(MetricsBlock))
+    {
+        close(fd);
+        return nullptr;
+    }
+    void * map = mmap(nullptr, sizeof(MetricsBlock), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    const MetricsBlock * block = (const MetricsBlock *) map;
+    if(memcmp(block->magic, METRICS_MAGIC, 8) != 0 || block->version != METRICS_VERSION)
+    {
+        munmap(map, sizeof(MetricsBlock));
+        return nullptr;
+    }
+    return block;
+}
+
+// Returns true if the process that published a block is still running
+bool running(const MetricsBlock * block)
+{
+    return kill(block->pid, 0) == 0 || errno == EPERM;
+}
+
+// Maps every segment in /dev/shm that is not mapped yet
+void findSegments(std::vector<Segment> & segments)
+{
+    DIR * dir = opendir("/dev/shm");
+    if(dir == nullptr)
+    {
+        return;
+    }
+    for(struct dirent * entry = readdir(dir); entry != nullptr; entry = readdir(dir))
+    {
+        if(strncmp(entry->d_name, "soli.", 5) != 0)
+        {
+            continue;
+        }
+        std::string path = std::string("/dev/shm/") + entry->d_name;
+        bool known = false;
+        for(size_t i = 0; i < segments.size(); i++)
+        {
+            known = known || segments[i].path == path;
+        }
+        const MetricsBlock * block = known ? nullptr : mapSegment(path.c_str());
+        if(block != nullptr && !running(block))
+        {
+            // Left behind by a process that did not exit cleanly
+            munmap((void *) block, sizeof(MetricsBlock));
+        }
+        else if(block != nullptr)
+        {
+            Segment segment;
+            segment.path = path;
+            segment.block = block;
+            for(int i = 0; i < METRIC_COUNT; i++)
+            {
+                segment.last[i] = block->counters[i].load(std::memory_order_relaxed);
+            }
+            segments.push_back(segment);
+        }
+    }
+    closedir(dir);
+}
+
+int main(int argc, char ** argv)
+{
+    int interval = argc > 1 ? atoi(argv[1]) : 1000;
+    int samples = argc > 2 ? atoi(argv[2]) : 0;
+    if(interval <= 0)
+    {
+        printf("Usage: %s [interval ms] [samples]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Segment> segments;
+    findSegments(segments);
+    for(int sample = 0; samples == 0 || sample < samples; sample++)
+    {
+        usleep(interval * 1000);
+        findSegments(segments);
+        double seconds = interval / 1000.0;
+        printf("%-10s %7s %9s %10s %11s %7s %9s %9s %10s %12s\n", "program", "pid", "games/s", "moves/s",
+            "nodes/s", "tt hit", "frame ms", "max ms", "allocs/s", "games");
+        for(size_t s = 0; s < segments.size();)
+        {
+            Segment & segment = segments[s];
+            const MetricsBlock * block = segment.block;
+            uint64_t now[METRIC_COUNT];
+            uint64_t delta[METRIC_COUNT];
+            for(int i = 0; i < METRIC_COUNT; i++)
+            {
+                now[i] = block->counters[i].load(std::memory_order_relaxed);
+                delta[i] = now[i] - segment.last[i];
+                segment.last[i] = now[i];
+            }
+            double hitrate = delta[ttprobes] > 0 ? 100.0 * delta[tthits] / delta[ttprobes] : 0;
+            double framems = delta[framesdrawn] > 0 ? delta[framenanos] / 1e6 / delta[framesdrawn] : 0;
+            printf("%-10.15s %7u %9.1f %10.0f %11.0f %6.1f%% %9.2f %9.2f %10.0f %12llu\n", block->program, block->pid,
+                delta[gamesplayed] / seconds, delta[movesapplied] / seconds, delta[solvernodes] / seconds, hitrate,
+                framems, block->framemax.load(std::memory_order_relaxed) / 1e6, delta[allocations] / seconds,
+                (unsigned long long) now[gamesplayed]);
+
+            // Segments of processes that exited are dropped after their last sample
+            if(!running(block))
+            {
+                munmap((void *) block, sizeof(MetricsBlock));
+                segments.erase(segments.begin() + s);
+            }
+            else
+            {
+                s++;
+            }
+        }
+        if(segments.empty())
+        {
+            printf("No running programs publish metrics\n");
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,533 @@
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include <cstdlib>
+#include <ctime>
+#include "gameboard.h"
+
+static const int pilelens[12] =  // The lengths of each pile in GB
+{25, 14, 14, 14, 14, 20, 20, 20, 20, 20, 20, 20};
+
+// Frozen copy of the rules engine, kept as the reference model that difftest checks faster
+// versions of GameBoard against. A deliberate change to the rules must be made here too,
+// never a change made only to get GameBoard to agree
+// Only what the rules need is kept: dealing, moveCard, draw, boardRefresh and saveState
+class ReferenceBoard
+{
+private:
+    int points = 0;                     // Current score
+    int maxdraw = 23;                   // An inclusive number for the max index of drawn cards
+    int drawtype;                       // An int representing the draw type of the game (1 or 3)
+    unsigned int seed;                  // Seed used to shuffle the deck
+    bool drawncards[25];                // true for drawn cards, false for not
+    Card * PH = new Card();             // Placeholder card to prevent segfaults
+    Card ** allcards = new Card * [52]; // Original 52 cards
+    Card *** GB = new Card ** [12];     // 12 rows of varying length card piles
+
+    Vector locationOf(Card * card)
+    {
+        Vector location;
+        location.y = -1;
+        location.x = -1;
+        for(int y = 0; y < 12; y++)
+        {
+            for(int x = 0; x < pilelens[y]; x++)
+            {
+                if(GB[y][x]->equals(card))
+                {
+                    location.y = y;
+                    location.x = x;
+                    return location;
+                }
+            }
+        }
+        return location;
+    }
+
+    Vector locationOf(Card * card, int y)
+    {
+        Vector location;
+        location.y = y;
+        location.x = -1;
+        for(int x = 0; x < pilelens[y]; x++)
+        {
+            if(GB[y][x]->equals(card))
+            {
+                location.x = x;
+                return location;
+            }
+        }
+        return location;
+    }
+
+    // Makes last in drawncards false and decrease maximum cards by 1
+    void decreaseDrawMax()
+    {
+        if(--maxdraw < -1)
+        {
+            maxdraw = -1;
+        }
+        if(maxdraw != -1)
+        {
+            for(int i = 24; i >= 0; i--)
+            {
+                if(drawncards[i])
+                {
+                    drawncards[i] = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Make all items in drawncards false
+    void undraw()
+    {
+        for(int i = 0; i < 25; i++)
+        {
+            drawncards[i] = false;
+        }
+    }
+
+    // Shuffles and deals the cards for a given seed
+    void deal(unsigned int s)
+    {
+        seed = s;
+        unsigned int randstate = s;
+
+        // Generate random indices
+        bool repeating = true;
+        int randnums[52];
+        int i;
+        for(i = 0; i < 52; i++)
+        {
+            randnums[i] = rand_r(&randstate) % 52;
+        }
+        while(repeating)
+        {
+            repeating = false;
+            for(i = 0; i < 52; i++)
+            {
+                for(int j = 0; j < 52; j++)
+                {
+                    if(j != i && randnums[j] == randnums[i])
+                    {
+                        randnums[j] = rand_r(&randstate) % 52;
+                        repeating = true;
+                    }
+                }
+            }
+        }
+
+        // Create 52 cards
+        i = 0;
+        for(int v = 0; v < 13; v++)
+        {
+            for(int s = 0; s < 4; s++)
+            {
+                allcards[randnums[i++]] = new Card(v + 1, suits[s], false);
+            }
+        }
+
+        // Add piles to GB's rows
+        for(i = 0; i < 12; i++)
+        {
+            GB[i] = new Card * [pilelens[i]];
+        }
+
+        // Add PH to GB
+        for(int y = 0; y < 12; y++)
+        {
+            for(int x = 0; x < pilelens[y]; x++)
+            {
+                GB[y][x] = PH;
+            }
+        }
+
+        // Add cards to tableau
+        i = 1;
+        int count = 0;
+        for(int y = 5; y < 12; y++, i++)
+        {
+            for(int x = 0; x < i; x++)
+            {
+                GB[y][x] = allcards[count++];
+            }
+        }
+
+        // Add cards to discard
+        for(i = 28; i < 52; i++)
+        {
+            allcards[i]->reveal();
+            GB[0][i - 28] = allcards[i];
+        }
+
+        // Make all cards not drawn
+        for(i = 0; i < 25; i++)
+        {
+            drawncards[i] = false;
+        }
+    }
+
+public:
+    // Constructor method for a board shuffled from a given seed
+    ReferenceBoard(int dt, unsigned int s)
+    {
+        drawtype = dt;
+        deal(s);
+    }
+
+    // Returns the index of the last drawn card in the discard, -1 if no cards are drawn
+    int lastDrawn()
+    {
+        for(int x = 24; x >= 0; x--)
+        {
+            if(drawncards[x])
+            {
+                return x;
+            }
+        }
+        return -1;
+    }
+
+    // Returns the last card in a given pile
+    Card * last(int y)
+    {
+        if(y != 0)
+        {
+            for(int x = pilelens[y] - 1; x >= 0; x--)
+            {
+                if(!GB[y][x]->getPH())
+                {
+                    return GB[y][x];
+                }
+            }
+            return GB[y][0];
+        }
+        else
+        {
+            for(int x = 24; x >=0; x--)
+            {
+                if(drawncards[x])
+                {
+                    return GB[0][x];
+                }
+            }
+            return GB[0][0];
+        }
+    }
+
+    // Checks and fixes the gameboard
+    void boardRefresh()
+    {
+        // Checks for null pointers and replaces with placeholder
+        for(int y = 0; y < 12; y++)
+        {
+            for(int x = 0; x < pilelens[y]; x++)
+            {
+                if(GB[y][x] == nullptr)
+                {
+                    GB[y][x] = PH;
+                }
+            }
+        }
+
+        // Checks for reveals last cards in tableau
+        for(int y = 5; y < 12; y++)
+        {
+            last(y)->reveal();
+        }
+
+        // Shifts all cards in discard to the left if a card is missing/moved
+        int startpoint = -1;
+        for(int x = 0; x <= maxdraw; x++)
+        {
+            if(GB[0][x]->getPH() && !GB[0][x + 1]->getPH())
+            {
+                startpoint = x;
+                break;
+            }
+        }
+        if(startpoint != -1)
+        {
+            for(int x = startpoint; x <= maxdraw; x++)
+            {
+                GB[0][x] = GB[0][(x + 1)];
+                GB[0][(x + 1)] = PH;
+            }
+        }
+    }
+
+    // Writes the whole board into STATE_SIZE bytes of buf, in the same format as GameBoard
+    void saveState(unsigned char * buf)
+    {
+        int n = 0;
+        for(int y = 0; y < 12; y++)
+        {
+            for(int x = 0; x < pilelens[y]; x++)
+            {
+                if(GB[y][x]->getPH())
+                {
+                    buf[n++] = 0;
+                }
+                else
+                {
+                    buf[n++] = (GB[y][x]->getID() + 1) | (GB[y][x]->getRevealed() ? 0x80 : 0);
+                }
+            }
+        }
+        for(int i = 0; i < 4; i++)
+        {
+            buf[n + i] = 0;
+        }
+        for(int i = 0; i < 25; i++)
+        {
+            if(drawncards[i])
+            {
+                buf[n + i / 8] |= 1 << (i % 8);
+            }
+        }
+        n += 4;
+        buf[n++] = maxdraw + 1;
+        for(int i = 0; i < 4; i++)
+        {
+            buf[n++] = (points >> (8 * i)) & 0xFF;
+        }
+    }
+
+    // Returns a bool representing whether a game is won or not
+    bool isWon()
+    {
+        for(int y = 1; y < 5; y++)
+        {
+            for(int x = 0; x < 13; x++)
+            {
+                if(GB[y][x]->getPH())
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Moves selected card to selected pile if possible and returns true if successful, false if not
+    bool moveCard(int boardy, int boardx, int pileindex)
+    {
+        // Immediate movement disqualifiers
+        if
+        (
+            pileindex == 0 ||
+            boardy == pileindex ||
+            GB[boardy][boardx]->getPH() ||
+            !GB[boardy][boardx]->getRevealed() ||
+            (boardy >= 1 && boardy <= 4 && boardx != 0) ||
+            (boardy == 0 && !drawncards[boardx])
+        )
+        {
+            return false;
+        }
+        // Checks for movement based on valid locations
+        if(boardy == 0) // Movement from discard
+        {
+            int lastcard = -1;
+            for(int i = 24; i >= 0; i--)
+            {
+                if(GB[0][i]->equals(last(0)))
+                {
+                    lastcard = i;
+                }
+            }
+            if((lastcard > 2 && boardx == 2) || lastcard == boardx) // Valid movement from discard
+            {
+                if(pileindex >= 1 && pileindex <= 4) // Move to foundation
+                {
+                    if(last(pileindex)->getPH() && last(0)->getIVal() == 1) // Valid move
+                    {
+                        GB[pileindex][0] = last(0);
+                        GB[locationOf(last(0)).y][locationOf(last(0)).x] = PH;
+                        decreaseDrawMax();
+                        return true;
+                    }
+                    else if(last(pileindex)->getSuit() == last(0)->getSuit() && last(pileindex)->getIVal() == last(0)->getIVal() - 1)
+                    {
+                        GB[pileindex][locationOf(last(pileindex)).x + 1] = last(0);
+                        GB[locationOf(last(0)).y][locationOf(last(0)).x] = PH;
+                        decreaseDrawMax();
+                        return true;
+                    }
+                }
+                else if(pileindex > 4) // Movement to tableau
+                {
+                    if(last(pileindex)->getPH() && last(boardy)->getIVal() == 13)
+                    {
+                        GB[pileindex][0] = last(boardy);
+                        GB[locationOf(last(boardy)).y][locationOf(last(boardy)).x] = PH;
+                        decreaseDrawMax();
+                        return true;
+                    }
+                    for(int x = 0; x < pilelens[pileindex]; x++)
+                    {
+                        if
+                        (
+                            GB[pileindex][x]->getPH() && 
+                            last(boardy)->getColor() != last(pileindex)->getColor() && 
+                            last(boardy)->getIVal() == last(pileindex)->getIVal() - 1
+                        ) // Valid movement
+                        {
+                            GB[pileindex][x] = last(boardy);
+                            GB[locationOf(last(boardy)).y][locationOf(last(boardy)).x] = PH;
+                            decreaseDrawMax();
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        else if(boardy >= 1 && boardy <= 4) // Movement from foundation
+        {
+            if(pileindex > 4) // Movement to tableau
+            {
+                for(int x = 0; x < pilelens[pileindex]; x++)
+                {
+                    if
+                    (
+                        GB[pileindex][x]->getPH() && 
+                        last(boardy)->getColor() != last(pileindex)->getColor() && 
+                        last(boardy)->getIVal() == last(pileindex)->getIVal() - 1
+                    ) // Valid movement
+                    {
+                        GB[pileindex][x] = last(boardy);
+                        GB[locationOf(last(boardy)).y][locationOf(last(boardy)).x] = PH;
+                        return true;
+                    }
+                }
+            }
+        }
+        else if(boardy > 4) // Movement from tableau
+        {
+            if(pileindex >= 1 && pileindex <= 4) // Movement to foundation
+            {
+                if(last(pileindex)->getPH() && last(boardy)->getIVal() == 1) // Valid move
+                    {
+                        GB[pileindex][0] = last(boardy);
+                        GB[boardy][boardx] = PH;
+                        return true;
+                    }
+                    else if(last(pileindex)->getSuit() == last(boardy)->getSuit() && last(pileindex)->getIVal() == last(boardy)->getIVal() - 1)
+                    {
+                        GB[pileindex][locationOf(last(pileindex)).x + 1] = last(boardy);
+                        GB[boardy][boardx] = PH;
+                        return true;
+                    }
+            }
+            else if(pileindex > 4) // Movement to tableau
+            {
+                bool singlecard = false;
+                if(GB[boardy][boardx + 1]->getPH())
+                {
+                    singlecard = true;
+                }
+                if(last(pileindex)->getPH() && GB[boardy][boardx]->getIVal() == 13) // Valid movement with King to empty spot
+                {
+                    for(int x = boardx; x < pilelens[boardy]; x++)
+                    {
+                        if(!GB[boardy][x]->getPH())
+                        {
+                            GB[pileindex][x - boardx] = GB[boardy][x];
+                            GB[boardy][x] = PH;
+                        }
+                        else
+                        {
+                            break;
+                        }
+                    }
+                    return true;
+                }
+                else if
+                (
+                    GB[boardy][boardx]->getColor() != last(pileindex)->getColor() &&
+                    GB[boardy][boardx]->getIVal() == last(pileindex)->getIVal() - 1
+                ) // Valid movement of non-king card
+                {
+                    if(singlecard)
+                    {
+                        GB[locationOf(last(pileindex)).y][locationOf(last(pileindex)).x + 1] = GB[boardy][boardx];
+                        GB[boardy][boardx] = PH;
+                        return true;
+                    }
+                    else // if moving multiple cards
+                    {
+                        for(int x = boardx; x < pilelens[boardy]; x++)
+                        {
+                            if(!GB[boardy][x]->getPH())
+                            {
+                                GB[pileindex][(locationOf(PH, pileindex).x)] = GB[boardy][x];
+                                GB[boardy][x] = PH;
+                            }
+                            else
+                            {
+                                break;
+                            }
+                        }
+                        return true;
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // Deallocates all pointers
+    void deallocate()
+    {
+        delete PH;
+
+        for(int i = 0; i < 52; i++)
+        {
+            delete allcards[i];
+        }
+        delete[] allcards;
+
+        for(int i = 0; i < 12; i++)
+        {
+            delete[] GB[i];
+        }
+        delete[] GB;
+    }
+
+    // Draws 1 or 3 cards
+    void draw()
+    {
+        int startpoint = -1;
+        for(int i = 0; i <= maxdraw; i++) // Find where the undrawn card is
+        {
+            if(!drawncards[i])
+            {
+                startpoint = i;
+                break;
+            }
+        }
+        if(startpoint != -1) // Draw 1 or 3 cards
+        {
+            for(int i = startpoint; i < startpoint + drawtype; i++)
+            {
+                if(i <= maxdraw)
+                {
+                    drawncards[i] = true;
+                }
+                else
+                {
+                    return;
+                }
+            }
+        }
+        else // Put all cards back in the deck
+        {
+            undraw();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,164 @@
+// Exports the games in a game store as asciicast recordings
+// Usage: replayexport <directory> [file] [player]
+// Build: clang++ -std=gnu++11 -O2 -pthread -lncurses replayexport.cpp -o replayexport
+//
+// Every game, or every game of one player, is replayed from its deal and written to
+// <directory>/<player>-<segment>-<game>.cast, one frame for the deal and one after each
+// move. Each frame shows the cursor on the card the next move takes and the pile it goes
+// to, as the front end would. Frames are spaced by the game's mean time per move, but at
+// least 0.1 seconds apart. A directory of - lays out and encodes the recordings without
+// writing them, to measure the renderer. Games are shared between all hardware threads
+#define SOLI_METRICS_MAIN // Count allocations in this program
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gameboard.h"
+#include "gamestore.h"
+#include "metrics.h"
+
+typedef BasicRecording<GameBoard::Screen::HEIGHT, GameBoard::Screen::WIDTH> Recording;
+
+// A game in the store
+typedef struct
+{
+    uint32_t segment; // Segment index
+    uint32_t game;    // Game index in the segment
+} GameRef;
+
+// Replays a game into a recording, returns the number of frames
+// Moves that the board rejects are shown like any other, so a recording matches the store
+int record(GameStoreReader & store, const GameRef & ref, std::vector<Move> & moves, std::string & out)
+{
+    GameColumns columns = store.columns(ref.segment);
+    store.moves(ref.segment, ref.game, moves);
+    char title[96];
+    snprintf(title, sizeof(title), "%.16s, seed %u, draw %u", columns.header->player, columns.seeds[ref.game],
+        columns.drawtypes[ref.game]);
+    double interval = moves.empty() ? 0 : columns.durations[ref.game] / 1000.0 / moves.size();
+    interval = interval < 0.1 ? 0.1 : interval;
+
+    GameBoard * board = new GameBoard(columns.drawtypes[ref.game], columns.seeds[ref.game]);
+    board->boardRefresh(); // Turns up the last card of each pile, as the front end does before the first frame
+    GameBoard::Screen screen;
+    Recording recording(title);
+    for(size_t i = 0; i <= moves.size(); i++)
+    {
+        if(i < moves.size() && moves[i].boardy != -1)
+        {
+            board->layout(screen, moves[i].boardy, moves[i].boardx, true, moves[i].pileindex);
+        }
+        else
+        {
+            board->layout(screen, -1, -1, false, -1);
+        }
+        recording.frame(screen, i * interval);
+        if(i < moves.size())
+        {
+            board->applyMove(moves[i]);
+        }
+    }
+    board->deallocate();
+    delete board;
+    out = recording.text();
+    return moves.size() + 1;
+}
+
+int main(int argc, char ** argv)
+{
+    if(argc < 2)
+    {
+        printf("Usage: %s <directory> [file] [player]\n", argv[0]);
+        return 1;
+    }
+    const char * directory = argv[1];
+    bool writing = strcmp(directory, "-") != 0;
+    const char * path = argc > 2 ? argv[2] : "games.db";
+    const char * player = argc > 3 ? argv[3] : nullptr;
+
+    GameStoreReader store;
+    if(!store.open(path))
+    {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+    std::vector<GameRef> games;
+    for(size_t s = 0; s < store.segmentCount(); s++)
+    {
+        const GameSegmentHeader * header = store.segment(s);
+        if(player != nullptr && strncmp(header->player, player, sizeof(header->player)) != 0)
+        {
+            continue;
+        }
+        for(uint32_t g = 0; g < header->count; g++)
+        {
+            GameRef ref;
+            ref.segment = s;
+            ref.game = g;
+            games.push_back(ref);
+        }
+    }
+    metricsPublish("replayexport");
+
+    std::atomic<size_t> next(0);
+    std::atomic<unsigned long> frames(0);
+    std::atomic<unsigned long> bytes(0);
+    std::atomic<unsigned long> failed(0);
+    unsigned int threadcount = std::thread::hardware_concurrency();
+    if(threadcount == 0)
+    {
+        threadcount = 1;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(unsigned int t = 0; t < threadcount; t++)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            std::vector<Move> moves;
+            std::string out;
+            unsigned long count = 0;
+            unsigned long written = 0;
+            for(size_t i = next++; i < games.size(); i = next++)
+            {
+                count += record(store, games[i], moves, out);
+                written += out.size();
+                metricsCount(gamesplayed);
+                if(!writing)
+                {
+                    continue;
+                }
+                const GameSegmentHeader * header = store.segment(games[i].segment);
+                std::string file = std::string(directory) + "/" +
+                    std::string(header->player, strnlen(header->player, sizeof(header->player))) + "-" +
+                    std::to_string(games[i].segment) + "-" + std::to_string(games[i].game) + ".cast";
+                FILE * f = fopen(file.c_str(), "wb");
+                bool ok = f != nullptr && fwrite(out.data(), 1, out.size(), f) == out.size();
+                ok = f != nullptr && fclose(f) == 0 && ok;
+                failed += !ok;
+            }
+            frames += count;
+            bytes += written;
+            metricsFlush();
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu games, %lu frames, %.1f MB on %u threads in %.2f s\n", games.size(), (unsigned long) frames,
+        bytes / 1e6, threadcount, seconds);
+    printf("%.0f frames per millisecond, %.1f bytes per frame\n", seconds > 0 ? frames / seconds / 1000 : 0,
+        frames > 0 ? (double) bytes / frames : 0);
+    if(failed > 0)
+    {
+        printf("%lu recordings could not be written to %s\n", (unsigned long) failed, directory);
+    }
+    metricsUnpublish();
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+#ifndef SAVEGAME_H
+#define SAVEGAME_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "atomicfile.h"
+#include "gameboard.h"
+#include "history.h"
+
+static const char SAVE_MAGIC[8] = {'S', 'O', 'L', 'I', 'S', 'A', 'V', 'E'};
+static const uint32_t SAVE_VERSION = 2;
+
+// Header at the start of a save file
+// The header is followed by the current board (STATE_SIZE bytes), then 3 bytes for each
+// recorded move (boardy + 1, boardx, pileindex), then the history's checkpoints
+typedef struct
+{
+    char magic[8];            // Always SAVE_MAGIC
+    uint32_t version;         // Always SAVE_VERSION
+    uint32_t statesize;       // STATE_SIZE of the program that wrote the file
+    uint32_t drawtype;        // Draw type of the game (1 or 3)
+    uint32_t seed;            // Seed the game was dealt from
+    uint32_t interval;        // Moves between history checkpoints
+    uint32_t position;        // Number of moves applied to the board
+    uint32_t movecount;       // Number of moves recorded
+    uint32_t checkpointcount; // Number of history checkpoints, movecount / interval + 1
+    uint32_t duration;        // Milliseconds the game has been played, over every session
+} SaveHeader;
+
+// Writes a board, its history and the milliseconds it has been played to path, returns
+// true if successful
+inline bool saveGame(const char * path, GameBoard * board, History * history, uint32_t duration)
+{
+    SaveHeader header;
+    memcpy(header.magic, SAVE_MAGIC, 8);
+    header.version = SAVE_VERSION;
+    header.statesize = STATE_SIZE;
+    header.drawtype = board->getDrawType();
+    header.seed = board->getSeed();
+    header.interval = history->getInterval();
+    header.position = history->getPosition();
+    header.movecount = history->length();
+    header.checkpointcount = history->checkpointCount();
+    header.duration = duration;
+
+    std::vector<uint8_t> data(sizeof(header) + STATE_SIZE + 3 * header.movecount +
+        header.checkpointcount * STATE_SIZE);
+    uint8_t * out = data.data();
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    board->saveState(out);
+    out += STATE_SIZE;
+    const std::vector<Move> & moves = history->getMoves();
+    for(size_t i = 0; i < moves.size(); i++)
+    {
+        *out++ = moves[i].boardy + 1;
+        *out++ = moves[i].boardx;
+        *out++ = moves[i].pileindex;
+    }
+    memcpy(out, history->getCheckpoints(), header.checkpointcount * STATE_SIZE);
+    return writeFileAtomically(path, data);
+}
+
+// Restores a board and its history from path, returns nullptr if there is no valid save
+// The board, every checkpoint and every move are checked with GameBoard::validState and
+// GameBoard::validMove, so a damaged save is ignored instead of loading a board the engine
+// cannot handle, without the cost of replaying the game
+// The caller owns the returned board and *history, and *duration is set to the milliseconds
+// the game has been played
+inline GameBoard * loadGame(const char * path, History ** history, uint32_t * duration)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(SaveHeader))
+    {
+        close(fd);
+        return nullptr;
+    }
+    size_t len = st.st_size;
+    void * map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    const unsigned char * in = (const unsigned char *) map;
+    SaveHeader header;
+    memcpy(&header, in, sizeof(header));
+    if
+    (
+        memcmp(header.magic, SAVE_MAGIC, 8) != 0 ||
+        header.version != SAVE_VERSION ||
+        header.statesize != (uint32_t) STATE_SIZE ||
+        (header.drawtype != 1 && header.drawtype != 3) ||
+        header.interval == 0 ||
+        header.position > header.movecount ||
+        header.checkpointcount != header.movecount / header.interval + 1 ||
+        len != sizeof(header) + STATE_SIZE + 3 * (size_t) header.movecount +
+            (size_t) header.checkpointcount * STATE_SIZE
+    )
+    {
+        munmap(map, len);
+        return nullptr;
+    }
+    in += sizeof(header);
+    const unsigned char * state = in;
+    in += STATE_SIZE;
+    std::vector<Move> moves(header.movecount);
+    bool valid = true;
+    for(uint32_t i = 0; i < header.movecount; i++)
+    {
+        moves[i].boardy = *in++ - 1;
+        moves[i].boardx = *in++;
+        moves[i].pileindex = *in++;
+        valid = valid && GameBoard::validMove(moves[i]);
+    }
+    const unsigned char * checkpoints = in;
+    valid = valid && GameBoard::validState(state);
+    for(uint32_t i = 0; valid && i < header.checkpointcount; i++)
+    {
+        valid = GameBoard::validState(checkpoints + i * STATE_SIZE);
+    }
+    if(!valid)
+    {
+        munmap(map, len);
+        return nullptr;
+    }
+    GameBoard * board = new GameBoard(header.drawtype, header.seed, state);
+    *history = new History(header.interval, header.position, moves, checkpoints, header.checkpointcount);
+    *duration = header.duration;
+    munmap(map, len);
+    return board;
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <cstring>
+#include <ncurses.h>
+#include <string>
+
+// Grid of characters and color pairs that a board is laid out into
+// Laying out does not touch a terminal, so any number of threads can lay out boards at
+// once, and a back end draws the grid to curses or writes it to a recording
+// Color pairs are numbered as main sets them up:
+//   1 white on black, 2 red on black, 3 black on white (cursor), 4 white on red (cursor)
+template <int ROWS, int COLS>
+class BasicScreen
+{
+public:
+    enum
+    {
+        HEIGHT = ROWS, // Rows in the grid
+        WIDTH = COLS   // Columns in the grid
+    };
+
+    char text[ROWS][COLS];           // Character in each cell
+    unsigned char pairs[ROWS][COLS]; // Color pair of each cell
+
+    // Sets row y to line, which is WIDTH characters, in color pair 1
+    void fillRow(int y, const char * line)
+    {
+        memcpy(text[y], line, COLS);
+        memset(pairs[y], 1, COLS);
+    }
+
+    // Sets the two cells at y, x to a and b in color pair pair
+    void put(int y, int x, char a, char b, int pair)
+    {
+        text[y][x] = a;
+        text[y][x + 1] = b;
+        pairs[y][x] = pair;
+        pairs[y][x + 1] = pair;
+    }
+};
+
+// Draws a grid to stdscr at the top left, leaving color pair 1 on
+// Each run of cells with the same color pair is one call to curses
+template <int ROWS, int COLS>
+void drawScreen(const BasicScreen<ROWS, COLS> & screen)
+{
+    for(int y = 0; y < ROWS; y++)
+    {
+        for(int x = 0; x < COLS;)
+        {
+            int run = 1;
+            while(x + run < COLS && screen.pairs[y][x + run] == screen.pairs[y][x])
+            {
+                run++;
+            }
+            attrset(COLOR_PAIR(screen.pairs[y][x]));
+            mvaddnstr(y, x, &screen.text[y][x], run);
+            x += run;
+        }
+    }
+    attrset(COLOR_PAIR(1));
+}
+
+// ANSI escapes for each color pair, as they are written in a JSON string
+static const char * const SCREEN_ESCAPES[5] =
+{"\\u001b[0m", "\\u001b[37;40m", "\\u001b[31;40m", "\\u001b[30;47m", "\\u001b[37;41m"};
+
+// Writes grids as an asciicast v2 recording, which asciinema and most web players replay
+// The recording is a JSON header line followed by one output event line for each frame.
+// Each event only redraws the cells that changed since the frame before it, so a move
+// costs a few escapes instead of a whole screen. Nothing is written until the caller takes
+// the text, so recordings can be made on any thread and without a terminal
+template <int ROWS, int COLS>
+class BasicRecording
+{
+private:
+    std::string out;               // The recording so far
+    BasicScreen<ROWS, COLS> shown; // The grid as the last frame left it
+    bool empty = true;             // Has no frame been written yet?
+
+    // Appends a character to the JSON string of an event
+    void appendChar(char c)
+    {
+        if(c == '"' || c == '\\')
+        {
+            out += '\\';
+        }
+        out += c;
+    }
+
+    // Appends a number that is not negative, without going through printf
+    void appendNumber(unsigned long n)
+    {
+        char digits[20];
+        int len = 0;
+        do
+        {
+            digits[len++] = '0' + n % 10;
+            n /= 10;
+        } while(n > 0);
+        while(len > 0)
+        {
+            out += digits[--len];
+        }
+    }
+
+    // Appends the escape that moves the cursor to y, x
+    void appendMove(int y, int x)
+    {
+        out += "\\u001b[";
+        appendNumber(y + 1);
+        out += ';';
+        appendNumber(x + 1);
+        out += 'H';
+    }
+public:
+    // Starts a recording with a title, which may be nullptr
+    explicit BasicRecording(const char * title)
+    {
+        out = "{\"version\": 2, \"width\": ";
+        appendNumber(COLS);
+        out += ", \"height\": ";
+        appendNumber(ROWS);
+        out += ", \"idle_time_limit\": 2";
+        if(title != nullptr)
+        {
+            out += ", \"title\": \"";
+            for(const char * c = title; *c != '\0'; c++)
+            {
+                appendChar(*c);
+            }
+            out += '"';
+        }
+        out += "}\n";
+    }
+
+    // Adds a frame shown seconds after the start of the recording
+    void frame(const BasicScreen<ROWS, COLS> & screen, double seconds)
+    {
+        unsigned long ms = seconds * 1000 + 0.5;
+        out += '[';
+        appendNumber(ms / 1000);
+        out += '.';
+        out += '0' + ms / 100 % 10;
+        out += '0' + ms / 10 % 10;
+        out += '0' + ms % 10;
+        out += ", \"o\", \"";
+        if(empty)
+        {
+            out += "\\u001b[2J";
+        }
+        int pair = 0;
+        for(int y = 0; y < ROWS; y++)
+        {
+            if(!empty && memcmp(screen.text[y], shown.text[y], COLS) == 0 && memcmp(screen.pairs[y], shown.pairs[y], COLS) == 0)
+            {
+                continue;
+            }
+            int cursor = -1; // Column the terminal's cursor is at in this row, -1 if unknown
+            for(int x = 0; x < COLS; x++)
+            {
+                if(!empty && screen.text[y][x] == shown.text[y][x] && screen.pairs[y][x] == shown.pairs[y][x])
+                {
+                    continue;
+                }
+
+                // A short gap in the current color is cheaper to write again than to jump over
+                bool rewrite = cursor != -1 && x - cursor <= 8;
+                for(int gap = cursor; rewrite && gap < x; gap++)
+                {
+                    rewrite = screen.pairs[y][gap] == pair;
+                }
+                if(rewrite)
+                {
+                    for(int gap = cursor; gap < x; gap++)
+                    {
+                        appendChar(screen.text[y][gap]);
+                    }
+                }
+                else if(x != cursor)
+                {
+                    appendMove(y, x);
+                }
+                if(screen.pairs[y][x] != pair)
+                {
+                    pair = screen.pairs[y][x];
+                    out += SCREEN_ESCAPES[pair < 5 ? pair : 0];
+                }
+                appendChar(screen.text[y][x]);
+                cursor = x + 1;
+            }
+        }
+        out += "\"]\n";
+        shown = screen;
+        empty = false;
+    }
+
+    // Returns the recording so far, which is a complete file after any number of frames
+    const std::string & text()
+    {
+        return out;
+    }
+};
+
+#endif
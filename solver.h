@@ -0,0 +1,351 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <chrono>
+#include <unordered_set>
+#include <vector>
+#include "gameboard.h"
+#include "metrics.h"
+#include "tablebase.h"
+#include "trace.h"
+
+// Depth first search for a winning line of play from a board
+// The search is bounded by a node limit, so a failed search only proves a deal
+// unwinnable when isComplete() is true
+// With a tablebase, late game positions are looked up instead of searched
+// Moves are generated from the Rules policy, and a tablebase must be generated for the same rules
+template <typename Rules>
+class BasicSolver
+{
+private:
+    typedef BasicGameBoard<Rules> Board;
+
+    // A board on the search stack and the moves left to try from it
+    struct Frame
+    {
+        Board * board;
+        std::vector<Move> moves;
+        int next = -1; // Index of the next move to try, -1 before the board is expanded
+    };
+
+
+    long nodelimit;                              // Maximum number of boards searched
+    long nodes = 0;                              // Number of boards searched so far
+    bool complete = true;                        // false if the node limit was reached
+    std::unordered_set<unsigned long long> seen; // Hashes of boards already searched
+    std::vector<Move> path;                      // Moves from the root to the current board
+    Tablebase * tablebase = nullptr;             // Late game positions, if any
+
+    // Returns true if card could be placed on top of the given pile
+    bool fits(Board * board, Card * card, int pileindex)
+    {
+        Card * top = board->last(pileindex);
+        if(Rules::kind(pileindex) == foundationpile)
+        {
+            return Rules::foundationAccepts(top, card);
+        }
+        return Rules::tableauAccepts(top, card);
+    }
+
+    // Adds a move to a list if its card fits on the destination
+    void addMove(Board * board, std::vector<Move> & moves, Card * card, int boardy, int boardx, int pileindex)
+    {
+        if(fits(board, card, pileindex))
+        {
+            Move move;
+            move.boardy = boardy;
+            move.boardx = boardx;
+            move.pileindex = pileindex;
+            moves.push_back(move);
+        }
+    }
+
+    // Follows the tablebase from a won late game board to a win, adding the moves to path
+    // Returns false and leaves path as it was if the tablebase has no next step
+    bool followTablebase(Board * board, int distance)
+    {
+        Board * current = board->clone();
+        size_t start = path.size();
+        std::vector<Move> moves;
+        while(!current->isWon())
+        {
+            candidateMoves(current, moves);
+            Board * next = nullptr;
+            for(size_t i = 0; i < moves.size() && next == nullptr; i++)
+            {
+                Board * child = current->clone();
+                bool won = false;
+                int d = 0;
+                if(moves[i].boardy != -1 && child->applyMove(moves[i]))
+                {
+                    if(child->isWon() || (tablebase->probe(child, won, d) && won && d < distance))
+                    {
+                        distance = child->isWon() ? 0 : d;
+                        path.push_back(moves[i]);
+                        next = child;
+                    }
+                }
+                if(next == nullptr)
+                {
+                    child->deallocate();
+                    delete child;
+                }
+            }
+            current->deallocate();
+            delete current;
+            if(next == nullptr)
+            {
+                path.resize(start);
+                return false;
+            }
+            current = next;
+        }
+        current->deallocate();
+        delete current;
+        return true;
+    }
+
+    // Adds the tableau to tableau moves whose card is the lowest face up card of its pile if
+    // uncovering is true, or every other face up card if not
+    // Moving a King that is already at the bottom of a pile is never useful and is left out
+    void addTableauMoves(Board * board, std::vector<Move> & moves, bool uncovering)
+    {
+        for(int y = Rules::FIRST_TABLEAU; y < Rules::PILES; y++)
+        {
+            for(int x = 0; x < Rules::capacity(y) - 1; x++)
+            {
+                Card * card = board->cardAt(y, x);
+                if(card->getPH())
+                {
+                    break;
+                }
+                if(!card->getRevealed() || (x > 0 && board->cardAt(y, x - 1)->getRevealed()) == uncovering)
+                {
+                    continue;
+                }
+                if(x == 0 && card->getIVal() == Rules::SUIT_CARDS)
+                {
+                    continue;
+                }
+                for(int p = Rules::FIRST_TABLEAU; p < Rules::PILES; p++)
+                {
+                    if(p != y)
+                    {
+                        addMove(board, moves, card, y, x, p);
+                    }
+                }
+            }
+        }
+    }
+public:
+    BasicSolver(long limit)
+    {
+        nodelimit = limit;
+    }
+
+    // Uses a tablebase for late game positions, or none if tb is nullptr
+    void setTablebase(Tablebase * tb)
+    {
+        tablebase = tb;
+    }
+
+    // Fills moves with the moves worth trying from a board, most promising first
+    // Moves that the engine would reject may be included
+    void candidateMoves(Board * board, std::vector<Move> & moves)
+    {
+        moves.clear();
+
+        // Moves to foundation
+        for(int y = 0; y < Rules::PILES; y++)
+        {
+            if(Rules::kind(y) == foundationpile)
+            {
+                continue;
+            }
+            Card * card = board->last(y);
+            int x = 0;
+            if(Rules::kind(y) == discardpile)
+            {
+                x = board->drawnColumn();
+                if(x < 0)
+                {
+                    continue;
+                }
+            }
+            else if(card->getPH())
+            {
+                continue;
+            }
+            else
+            {
+                for(x = Rules::capacity(y) - 1; board->cardAt(y, x)->getPH(); x--);
+            }
+            for(int f = Rules::FIRST_FOUNDATION; f < Rules::FIRST_TABLEAU; f++)
+            {
+                addMove(board, moves, card, y, x, f);
+            }
+        }
+
+        // Tableau moves that uncover a face down card or empty a pile, then discard to tableau
+        addTableauMoves(board, moves, true);
+        int drawn = board->drawnColumn();
+        if(drawn >= 0)
+        {
+            for(int p = Rules::FIRST_TABLEAU; p < Rules::PILES; p++)
+            {
+                addMove(board, moves, board->last(Rules::DISCARD), Rules::DISCARD, drawn, p);
+            }
+        }
+
+        // Tableau moves that split a face up run, then foundation to tableau
+        addTableauMoves(board, moves, false);
+        for(int f = Rules::FIRST_FOUNDATION; f < Rules::FIRST_TABLEAU; f++)
+        {
+            Card * card = board->last(f);
+            if(card->getPH())
+            {
+                continue;
+            }
+            for(int p = Rules::FIRST_TABLEAU; p < Rules::PILES; p++)
+            {
+                addMove(board, moves, card, f, 0, p);
+            }
+        }
+
+        // Draw
+        Move draw;
+        draw.boardy = -1;
+        draw.boardx = 0;
+        draw.pileindex = 0;
+        moves.push_back(draw);
+    }
+
+    // Searches from board and returns true if a win was found
+    // The search keeps its own stack of boards since winning lines can be thousands of moves deep
+    bool search(Board * board)
+    {
+        TRACE_SPAN("search");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        long startnodes = nodes;
+        long hits = 0;
+        std::vector<Frame> stack;
+        bool found = false;
+        stack.push_back(Frame());
+        stack.back().board = board;
+        while(!stack.empty() && !found)
+        {
+            Frame & frame = stack.back();
+            if(frame.next == -1)
+            {
+                frame.next = 0;
+                if(frame.board->isWon())
+                {
+                    found = true;
+                    break;
+                }
+                if(nodes >= nodelimit)
+                {
+                    complete = false;
+                    break;
+                }
+                nodes++;
+                bool won = false;
+                int distance = 0;
+                if(!seen.insert(frame.board->hashState()).second)
+                {
+                    // Already searched, so there is nothing to try
+                    hits++;
+                }
+                else if
+                (
+                    tablebase != nullptr &&
+                    tablebase->probe(frame.board, won, distance) &&
+                    (!won || followTablebase(frame.board, distance))
+                )
+                {
+                    // Lost positions have nothing worth trying either
+                    if(won)
+                    {
+                        found = true;
+                        break;
+                    }
+                }
+                else
+                {
+                    TRACE_SPAN("expand");
+                    candidateMoves(frame.board, frame.moves);
+                }
+            }
+            if(frame.next < (int) frame.moves.size())
+            {
+                Move move = frame.moves[frame.next++];
+                Board * child = frame.board->clone();
+                if(child->applyMove(move))
+                {
+                    path.push_back(move);
+                    stack.push_back(Frame());
+                    stack.back().board = child;
+                }
+                else
+                {
+                    child->deallocate();
+                    delete child;
+                }
+            }
+            else
+            {
+                if(stack.size() > 1)
+                {
+                    frame.board->deallocate();
+                    delete frame.board;
+                    path.pop_back();
+                }
+                stack.pop_back();
+            }
+        }
+
+        // Free every board except the caller's
+        for(size_t i = 1; i < stack.size(); i++)
+        {
+            stack[i].board->deallocate();
+            delete stack[i].board;
+        }
+        metricsCount(solvernodes, nodes - startnodes);
+        metricsCount(ttprobes, nodes - startnodes);
+        metricsCount(tthits, hits);
+        metricsCount(solversearches);
+        metricsCount(solvernanos, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        return found;
+    }
+
+    // Clears the results of the last search
+    void reset()
+    {
+        nodes = 0;
+        complete = true;
+        seen.clear();
+        path.clear();
+    }
+
+    // Returns true if the last search was not cut short by the node limit
+    bool isComplete()
+    {
+        return complete;
+    }
+
+    // Returns the number of boards searched
+    long getNodes()
+    {
+        return nodes;
+    }
+
+    // Returns the winning line of play found by the last search
+    const std::vector<Move> & getPath()
+    {
+        return path;
+    }
+};
+
+typedef BasicSolver<KlondikeRules> Solver;
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cmath>
+
+// Sets low and high to the 95% Wilson score interval for a rate of wins out of n trials
+// The interval stays inside 0 to 1 and is still useful for small n or rates near 0 or 1,
+// which is where win rates usually are. With no trials it is the whole range
+inline void wilsonInterval(double wins, double n, double & low, double & high)
+{
+    if(n <= 0)
+    {
+        low = 0;
+        high = 1;
+        return;
+    }
+    double p = wins / n;
+    double z = 1.96;
+    double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+    double half = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / (1 + z * z / n);
+    low = center - half;
+    high = center + half;
+}
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "atomicfile.h"
+#include "gameboard.h"
+
+static const char TABLEBASE_MAGIC[8] = {'S', 'O', 'L', 'T', 'B', 'A', 'S', 'E'};
+static const uint32_t TABLEBASE_VERSION = 1;
+static const int TABLEBASE_HIDDEN = 4;        // Most face down cards in a late game position
+static const uint16_t TABLEBASE_WIN = 0x8000; // Set in a value if the position is won
+
+// Header at the start of a tablebase file
+typedef struct
+{
+    char magic[8];      // Always TABLEBASE_MAGIC
+    uint32_t version;   // Always TABLEBASE_VERSION
+    uint32_t slotcount; // Number of slots, a power of 2
+    uint32_t entries;   // Number of slots in use
+    uint32_t pad;
+} TablebaseHeader;
+
+// One slot of the table, key 0 marks an empty slot
+typedef struct
+{
+    uint64_t key;   // Canonical hash of the position
+    uint16_t value; // TABLEBASE_WIN | distance to win for won positions, 0 for lost ones
+    uint16_t pad[3];
+} TablebaseSlot;
+
+// Returns true if a board is a late game position: the stock and discard are empty and
+// at most TABLEBASE_HIDDEN tableau cards are face down
+template <typename Rules>
+inline bool isLateGame(BasicGameBoard<Rules> * board)
+{
+    if(!board->cardAt(Rules::DISCARD, 0)->getPH())
+    {
+        return false;
+    }
+    int hidden = 0;
+    for(int y = Rules::FIRST_TABLEAU; y < Rules::PILES; y++)
+    {
+        for(int x = 0; x < Rules::capacity(y) && !board->cardAt(y, x)->getPH(); x++)
+        {
+            if(!board->cardAt(y, x)->getRevealed() && ++hidden > TABLEBASE_HIDDEN)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Returns a hash that is the same for positions that only differ in the order of the
+// foundation or tableau piles, which play the same, and is never 0
+template <typename Rules>
+inline uint64_t canonicalHash(BasicGameBoard<Rules> * board)
+{
+    // Foundations by suit, then the tableau piles in sorted order
+    std::string canonical(Rules::SUITS, '\0');
+    for(int f = Rules::FIRST_FOUNDATION; f < Rules::FIRST_TABLEAU; f++)
+    {
+        Card * card = board->last(f);
+        if(!card->getPH())
+        {
+            canonical[strchr(suits, card->getSuit()) - suits] = card->getIVal();
+        }
+    }
+    std::string columns[Rules::PILES - Rules::FIRST_TABLEAU];
+    for(int y = Rules::FIRST_TABLEAU; y < Rules::PILES; y++)
+    {
+        for(int x = 0; x < Rules::capacity(y) && !board->cardAt(y, x)->getPH(); x++)
+        {
+            Card * card = board->cardAt(y, x);
+            columns[y - Rules::FIRST_TABLEAU] += (char) ((card->getID() + 1) | (card->getRevealed() ? 0x80 : 0));
+        }
+        columns[y - Rules::FIRST_TABLEAU] += '\0';
+    }
+    std::sort(columns, columns + Rules::PILES - Rules::FIRST_TABLEAU);
+    for(int i = 0; i < Rules::PILES - Rules::FIRST_TABLEAU; i++)
+    {
+        canonical += columns[i];
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < canonical.size(); i++)
+    {
+        h = (h ^ (unsigned char) canonical[i]) * 1099511628211ULL;
+    }
+    return h == 0 ? 1 : h;
+}
+
+// Read-only, memory-mapped table of late game positions and their distance to a win
+// The table is open addressing with linear probing on the canonical hash, and stores the
+// full 64 bit hash rather than the position, so a probe only matches a different position
+// whose hash collides with it, which is unlikely but possible
+class Tablebase
+{
+private:
+    void * map = nullptr;                   // Mapped file
+    size_t maplen = 0;                      // Length of the mapped file
+    const TablebaseHeader * header = nullptr;
+    const TablebaseSlot * slots = nullptr;
+public:
+    ~Tablebase()
+    {
+        close();
+    }
+
+    // Maps a tablebase file and returns true if it is valid, false if not
+    bool open(const char * path)
+    {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(TablebaseHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        maplen = st.st_size;
+        map = mmap(nullptr, maplen, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(map == MAP_FAILED)
+        {
+            map = nullptr;
+            return false;
+        }
+        header = (const TablebaseHeader *) map;
+        if
+        (
+            memcmp(header->magic, TABLEBASE_MAGIC, 8) != 0 ||
+            header->version != TABLEBASE_VERSION ||
+            header->slotcount == 0 ||
+            (header->slotcount & (header->slotcount - 1)) != 0 ||
+            maplen != sizeof(TablebaseHeader) + header->slotcount * sizeof(TablebaseSlot)
+        )
+        {
+            close();
+            return false;
+        }
+        slots = (const TablebaseSlot *) (header + 1);
+        return true;
+    }
+
+    // Unmaps the file if one is open
+    void close()
+    {
+        if(map != nullptr)
+        {
+            munmap(map, maplen);
+        }
+        map = nullptr;
+        header = nullptr;
+        slots = nullptr;
+    }
+
+    // Returns the number of positions in the table
+    uint32_t size()
+    {
+        return header == nullptr ? 0 : header->entries;
+    }
+
+    // Looks up a late game position, returns false if it is not in the table
+    // Otherwise won is set and distance is the number of moves to a win for won positions
+    // The table only holds positions of the variant tbgen generated it for, which is Klondike
+    template <typename Rules>
+    bool probe(BasicGameBoard<Rules> * board, bool & won, int & distance)
+    {
+        if(header == nullptr || !isLateGame(board))
+        {
+            return false;
+        }
+        uint64_t key = canonicalHash(board);
+        uint32_t mask = header->slotcount - 1;
+        for(uint32_t i = key & mask; slots[i].key != 0; i = (i + 1) & mask)
+        {
+            if(slots[i].key == key)
+            {
+                won = (slots[i].value & TABLEBASE_WIN) != 0;
+                distance = slots[i].value & ~TABLEBASE_WIN;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Writes positions keyed by canonicalHash to a new tablebase file at half load
+    static bool write(const char * path, const std::unordered_map<uint64_t, uint16_t> & positions)
+    {
+        uint32_t slotcount = 1;
+        while(slotcount < positions.size() * 2)
+        {
+            slotcount *= 2;
+        }
+        // The table is built in place after the header, zeroed slots are empty
+        std::vector<uint8_t> data(sizeof(TablebaseHeader) + slotcount * sizeof(TablebaseSlot));
+        TablebaseSlot * table = (TablebaseSlot *) (data.data() + sizeof(TablebaseHeader));
+        for(std::unordered_map<uint64_t, uint16_t>::const_iterator it = positions.begin(); it != positions.end(); ++it)
+        {
+            uint32_t i = it->first & (slotcount - 1);
+            while(table[i].key != 0)
+            {
+                i = (i + 1) & (slotcount - 1);
+            }
+            table[i].key = it->first;
+            table[i].value = it->second;
+        }
+
+        TablebaseHeader header;
+        memcpy(header.magic, TABLEBASE_MAGIC, 8);
+        header.version = TABLEBASE_VERSION;
+        header.slotcount = slotcount;
+        header.entries = positions.size();
+        header.pad = 0;
+        memcpy(data.data(), &header, sizeof(header));
+        return writeFileAtomically(path, data);
+    }
+};
+
+#endif
@@ -0,0 +1,193 @@
+// Builds the endgame tablebase used by the solver for late game positions
+// Usage: tbgen <first seed> <count> [file] [position limit]
+// Build: clang++ -std=gnu++11 -pthread -lncurses tbgen.cpp -o tbgen
+//
+// For each seed the solver finds a win, and the first late game position on the way to it
+// becomes a root. Every position reachable from the root is enumerated, then retrograde
+// analysis works backwards from the won positions to find each one's distance to a win.
+// Positions that cannot reach a win are stored as lost.
+#define SOLI_METRICS_MAIN // Count allocations in this program
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+#include "gameboard.h"
+#include "metrics.h"
+#include "solver.h"
+#include "tablebase.h"
+#include "trace.h"
+
+// Enumerates every position reachable from root and adds them to positions with their
+// distance to a win, returns false without adding any if there are more than limit
+bool analyze(GameBoard * root, size_t limit, std::unordered_map<uint64_t, uint16_t> & positions)
+{
+    TRACE_SPAN("analyze");
+    std::vector<unsigned char> states;             // STATE_SIZE bytes for each position
+    std::vector<uint64_t> keys;                    // Canonical hash of each position
+    std::vector<std::vector<int> > predecessors;   // Positions with a move to each position
+    std::vector<int> wins;                         // Won positions
+    std::unordered_map<uint64_t, int> index;       // Position number by canonical hash
+    std::vector<Move> moves;
+    Solver * movegen = new Solver(0);
+    GameBoard * board = root->clone();
+
+    states.resize(STATE_SIZE);
+    root->saveState(states.data());
+    keys.push_back(canonicalHash(root));
+    predecessors.resize(1);
+    index[keys[0]] = 0;
+
+    // Breadth first enumeration of the positions and the moves between them
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        board->loadState(&states[i * STATE_SIZE]);
+        if(board->isWon())
+        {
+            wins.push_back(i);
+            continue;
+        }
+        movegen->candidateMoves(board, moves);
+        for(size_t m = 0; m < moves.size(); m++)
+        {
+            if(moves[m].boardy == -1)
+            {
+                continue;
+            }
+            GameBoard * child = board->clone();
+            if(child->applyMove(moves[m]))
+            {
+                uint64_t key = canonicalHash(child);
+                std::unordered_map<uint64_t, int>::iterator it = index.find(key);
+                int c;
+                if(it == index.end())
+                {
+                    c = keys.size();
+                    index[key] = c;
+                    keys.push_back(key);
+                    predecessors.resize(c + 1);
+                    states.resize((c + 1) * STATE_SIZE);
+                    child->saveState(&states[c * STATE_SIZE]);
+                }
+                else
+                {
+                    c = it->second;
+                }
+                predecessors[c].push_back(i);
+            }
+            child->deallocate();
+            delete child;
+        }
+        if(keys.size() > limit)
+        {
+            break;
+        }
+    }
+    board->deallocate();
+    delete board;
+    delete movegen;
+    if(keys.size() > limit)
+    {
+        return false;
+    }
+
+    // Retrograde analysis, a breadth first search backwards from the won positions
+    std::vector<int> distance(keys.size(), -1);
+    std::vector<int> queue = wins;
+    for(size_t i = 0; i < wins.size(); i++)
+    {
+        distance[wins[i]] = 0;
+    }
+    for(size_t q = 0; q < queue.size(); q++)
+    {
+        int s = queue[q];
+        for(size_t p = 0; p < predecessors[s].size(); p++)
+        {
+            int pred = predecessors[s][p];
+            if(distance[pred] == -1)
+            {
+                distance[pred] = distance[s] + 1;
+                queue.push_back(pred);
+            }
+        }
+    }
+
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        uint16_t value = 0;
+        if(distance[i] != -1)
+        {
+            value = TABLEBASE_WIN | (distance[i] < 0x7FFF ? distance[i] : 0x7FFF);
+        }
+        positions[keys[i]] = value;
+    }
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    if(argc < 3)
+    {
+        printf("Usage: %s <first seed> <count> [file] [position limit]\n", argv[0]);
+        return 1;
+    }
+    unsigned int first = strtoul(argv[1], nullptr, 10);
+    unsigned int count = strtoul(argv[2], nullptr, 10);
+    const char * path = argc > 3 ? argv[3] : "endgame.tb";
+    size_t limit = argc > 4 ? strtoul(argv[4], nullptr, 10) : 200000;
+
+    metricsPublish("tbgen");
+    std::unordered_map<uint64_t, uint16_t> positions;
+    Solver * solver = new Solver(200000);
+    unsigned int roots = 0;
+    unsigned int skipped = 0;
+    for(unsigned int seed = first; seed < first + count; seed++)
+    {
+        // Late game positions have no stock, so the draw type does not matter
+        GameBoard * board = new GameBoard(1, seed);
+        solver->reset();
+        if(solver->search(board))
+        {
+            GameBoard * replay = board->clone();
+            const std::vector<Move> & path = solver->getPath();
+            for(size_t i = 0; i < path.size() && !isLateGame(replay); i++)
+            {
+                replay->applyMove(path[i]);
+            }
+            if(isLateGame(replay) && !replay->isWon() && positions.count(canonicalHash(replay)) == 0)
+            {
+                if(analyze(replay, limit, positions))
+                {
+                    roots++;
+                }
+                else
+                {
+                    skipped++;
+                }
+            }
+            replay->deallocate();
+            delete replay;
+        }
+        board->deallocate();
+        delete board;
+        fprintf(stderr, "\r%u/%u seeds, %zu positions", seed - first + 1, count, positions.size());
+    }
+    fprintf(stderr, "\n");
+    delete solver;
+
+    unsigned int won = 0;
+    for(std::unordered_map<uint64_t, uint16_t>::iterator it = positions.begin(); it != positions.end(); ++it)
+    {
+        won += (it->second & TABLEBASE_WIN) != 0;
+    }
+    printf("%u roots, %u over the position limit, %zu positions, %u won\n", roots, skipped, positions.size(), won);
+
+    TRACE_WRITE("tbgen.trace.json");
+    metricsFlush();
+    metricsUnpublish();
+    if(!Tablebase::write(path, positions))
+    {
+        printf("Could not write %s\n", path);
+        return 1;
+    }
+    return 0;
+}
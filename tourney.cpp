@@ -0,0 +1,287 @@
+// Plays agents against each other on the same seeded deals and compares them
+// Usage: tourney <deals> [agents] [draw type] [first seed] [node limit] [tablebase] [games file]
+// Build: clang++ -std=gnu++11 -O2 -pthread -lncurses tourney.cpp -o tourney
+//
+// agents is a comma separated list such as random,greedy,solver. Every agent plays every
+// deal, so differences between agents are measured on the same deals and the paired test
+// only counts the deals where they disagree. A tablebase of - means none, and with a
+// games file every game is appended to that game store under the agent's name.
+#define SOLI_METRICS_MAIN // Count allocations in this program
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+#include "agents.h"
+#include "gameboard.h"
+#include "gamestore.h"
+#include "metrics.h"
+#include "stats.h"
+#include "tablebase.h"
+#include "trace.h"
+
+static const int MAX_MOVES = 10000; // Moves before a game counts as lost, solver lines can be thousands long
+
+// Totals for one agent
+typedef struct
+{
+    unsigned long games;     // Games played
+    unsigned long wins;      // Games won
+    unsigned long resigned;  // Games the agent resigned or played an illegal move in
+    double moves;            // Sum of the moves played in each game
+    double movessq;          // Sum of the squares of the moves played in each game
+    unsigned long decisions; // Moves chosen
+    double time;             // Sum of the nanoseconds taken by each decision
+    double timesq;           // Sum of the squares of the nanoseconds taken by each decision
+    double maxtime;          // Nanoseconds taken by the slowest decision
+} AgentStats;
+
+// Plays one game and adds it to stats and to store if it is not nullptr, returns true if
+// it was won
+bool play(Agent * agent, int drawtype, unsigned int seed, AgentStats * stats, GameStore * store)
+{
+    TRACE_SPAN("play");
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    GameBoard * board = new GameBoard(drawtype, seed);
+    metricsCount(gamesplayed);
+    agent->newGame(board, seed);
+    std::vector<Move> played;
+    int moves = 0;
+    while(!board->isWon() && moves < MAX_MOVES)
+    {
+        Move move;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool chosen = agent->choose(board, move);
+        double time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        stats->decisions++;
+        stats->time += time;
+        stats->timesq += time * time;
+        stats->maxtime = time > stats->maxtime ? time : stats->maxtime;
+        if(!chosen || !board->applyMove(move))
+        {
+            stats->resigned++;
+            break;
+        }
+        played.push_back(move);
+        moves++;
+    }
+    bool won = board->isWon();
+    stats->games++;
+    stats->wins += won;
+    stats->moves += moves;
+    stats->movessq += (double) moves * moves;
+    if(store != nullptr)
+    {
+        store->add(seed, drawtype, won ? gamewon : gamelost, time(NULL),
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count(), played);
+    }
+    board->deallocate();
+    delete board;
+    return won;
+}
+
+// Returns half the width of the 95% normal interval for the mean of n values
+double spread(double sum, double sumsq, double n)
+{
+    if(n < 2)
+    {
+        return 0;
+    }
+    double mean = sum / n;
+    double variance = (sumsq - n * mean * mean) / (n - 1);
+    return 1.96 * sqrt(variance > 0 ? variance / n : 0);
+}
+
+int main(int argc, char ** argv)
+{
+    if(argc < 2)
+    {
+        printf("Usage: %s <deals> [agents] [draw type] [first seed] [node limit] [tablebase] [games file]\n", argv[0]);
+        return 1;
+    }
+    unsigned int count = strtoul(argv[1], nullptr, 10);
+    std::string agentlist = argc > 2 ? argv[2] : "random,greedy,solver";
+    int drawtype = argc > 3 ? atoi(argv[3]) : 1;
+    unsigned int first = argc > 4 ? strtoul(argv[4], nullptr, 10) : 0;
+    long nodelimit = argc > 5 ? strtol(argv[5], nullptr, 10) : 20000;
+    Tablebase * tablebase = nullptr;
+    if(drawtype != 1 && drawtype != 3)
+    {
+        printf("Draw type must be 1 or 3\n");
+        return 1;
+    }
+    const char * gamespath = argc > 7 ? argv[7] : nullptr;
+    if(argc > 6 && strcmp(argv[6], "-") != 0)
+    {
+        tablebase = new Tablebase();
+        if(!tablebase->open(argv[6]))
+        {
+            printf("Could not open %s\n", argv[6]);
+            return 1;
+        }
+    }
+
+    std::vector<std::string> names;
+    for(size_t start = 0; start <= agentlist.size();)
+    {
+        size_t end = agentlist.find(',', start);
+        end = end == std::string::npos ? agentlist.size() : end;
+        names.push_back(agentlist.substr(start, end - start));
+        start = end + 1;
+    }
+    for(size_t a = 0; a < names.size(); a++)
+    {
+        Agent * agent = makeAgent(names[a].c_str(), nodelimit, tablebase);
+        if(agent == nullptr)
+        {
+            printf("Unknown agent %s, the agents are random, greedy and solver\n", names[a].c_str());
+            return 1;
+        }
+        delete agent;
+    }
+    size_t n = names.size();
+
+    // Each thread keeps its own totals and takes the next deal until all are played
+    // wonalone[a * n + b] counts the deals agent a won and agent b lost
+    unsigned int threadcount = std::thread::hardware_concurrency();
+    if(threadcount == 0)
+    {
+        threadcount = 1;
+    }
+    std::vector<std::vector<AgentStats> > stats(threadcount, std::vector<AgentStats>(n));
+    std::vector<std::vector<unsigned long> > wonalone(threadcount, std::vector<unsigned long>(n * n, 0));
+    for(unsigned int t = 0; t < threadcount; t++)
+    {
+        memset(stats[t].data(), 0, n * sizeof(AgentStats));
+    }
+    metricsPublish("tourney");
+    std::atomic<unsigned int> next(0);
+    std::atomic<unsigned int> done(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(unsigned int t = 0; t < threadcount; t++)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            std::vector<Agent *> agents;
+            std::vector<GameStore *> stores(n, nullptr);
+            std::vector<bool> won(n);
+            for(size_t a = 0; a < n; a++)
+            {
+                agents.push_back(makeAgent(names[a].c_str(), nodelimit, tablebase));
+                if(gamespath != nullptr)
+                {
+                    stores[a] = new GameStore(gamespath, names[a].c_str());
+                }
+            }
+            for(unsigned int i = next++; i < count; i = next++)
+            {
+                for(size_t a = 0; a < n; a++)
+                {
+                    won[a] = play(agents[a], drawtype, first + i, &stats[t][a], stores[a]);
+                }
+                for(size_t a = 0; a < n; a++)
+                {
+                    for(size_t b = 0; b < n; b++)
+                    {
+                        wonalone[t][a * n + b] += won[a] && !won[b];
+                    }
+                }
+                unsigned int finished = ++done;
+                if(finished % 100 == 0)
+                {
+                    fprintf(stderr, "\r%u/%u", finished, count);
+                }
+            }
+            for(size_t a = 0; a < n; a++)
+            {
+                delete agents[a];
+                delete stores[a];
+            }
+            metricsFlush();
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "\r%u/%u\n", count, count);
+
+    // Adds up the threads' totals into the first thread's
+    for(unsigned int t = 1; t < threadcount; t++)
+    {
+        for(size_t a = 0; a < n; a++)
+        {
+            AgentStats & total = stats[0][a];
+            AgentStats & part = stats[t][a];
+            total.games += part.games;
+            total.wins += part.wins;
+            total.resigned += part.resigned;
+            total.moves += part.moves;
+            total.movessq += part.movessq;
+            total.decisions += part.decisions;
+            total.time += part.time;
+            total.timesq += part.timesq;
+            total.maxtime = part.maxtime > total.maxtime ? part.maxtime : total.maxtime;
+        }
+        for(size_t i = 0; i < n * n; i++)
+        {
+            wonalone[0][i] += wonalone[t][i];
+        }
+    }
+
+    printf("%u deals from seed %u, draw %d, %u threads, %.1fs, %.0f games per hour\n",
+        count, first, drawtype, threadcount, seconds, seconds > 0 ? count * n * 3600 / seconds : 0);
+    printf("%-8s %20s %9s %16s %19s %12s\n", "agent", "win rate (95%)", "resigned", "moves (95%)", "us/decision (95%)", "slowest us");
+    for(size_t a = 0; a < n; a++)
+    {
+        AgentStats & s = stats[0][a];
+        double games = s.games > 0 ? s.games : 1;
+        double decisions = s.decisions > 0 ? s.decisions : 1;
+
+        double p = s.wins / games;
+        double low;
+        double high;
+        wilsonInterval(s.wins, games, low, high);
+
+        char winrate[32];
+        char moves[32];
+        char time[32];
+        snprintf(winrate, sizeof(winrate), "%5.1f%% [%.1f, %.1f]", 100 * p, 100 * low, 100 * high);
+        snprintf(moves, sizeof(moves), "%.1f +- %.1f", s.moves / games, spread(s.moves, s.movessq, s.games));
+        snprintf(time, sizeof(time), "%.1f +- %.1f", s.time / decisions / 1000, spread(s.time, s.timesq, s.decisions) / 1000);
+        printf("%-8s %20s %9lu %16s %19s %12.0f\n", names[a].c_str(), winrate, s.resigned, moves, time, s.maxtime / 1000);
+    }
+
+    // McNemar's test with continuity correction on the deals each pair disagrees on
+    if(n > 1)
+    {
+        printf("\n%-8s %-8s %10s %10s %10s\n", "agent", "vs", "won alone", "lost alone", "p");
+    }
+    for(size_t a = 0; a < n; a++)
+    {
+        for(size_t b = a + 1; b < n; b++)
+        {
+            double wins = wonalone[0][a * n + b];
+            double losses = wonalone[0][b * n + a];
+            double p = 1;
+            if(wins + losses > 0)
+            {
+                double chisq = pow(fabs(wins - losses) - 1 > 0 ? fabs(wins - losses) - 1 : 0, 2) / (wins + losses);
+                p = erfc(sqrt(chisq / 2));
+            }
+            printf("%-8s %-8s %10.0f %10.0f %10.4f\n", names[a].c_str(), names[b].c_str(), wins, losses, p);
+        }
+    }
+
+    delete tablebase;
+    TRACE_WRITE("tourney.trace.json");
+    metricsUnpublish();
+    return 0;
+}
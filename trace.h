@@ -0,0 +1,134 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline tracing in the Chrome trace event format, viewable in Perfetto or chrome://tracing
+// Tracing is compiled in with -DSOLI_TRACE, otherwise TRACE_SPAN and TRACE_WRITE do nothing
+//
+// TRACE_SPAN("name") records the time from that line to the end of the enclosing block
+// TRACE_WRITE("trace.json") writes every recorded span, and should be called once the
+// threads being traced have stopped
+#ifdef SOLI_TRACE
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+static const size_t TRACE_EVENTS = 1 << 16; // Spans kept for each thread, older ones are overwritten
+
+// One finished span
+typedef struct
+{
+    const char * name; // Name given to TRACE_SPAN, must be a string literal
+    int64_t start;     // Start time in nanoseconds
+    int64_t duration;  // Duration in nanoseconds
+} TraceEvent;
+
+// Ring of the spans recorded by one thread
+// Only its own thread writes to a buffer, so recording takes no lock
+typedef struct
+{
+    int tid;                         // Thread number shown in the trace
+    uint64_t count;                  // Spans recorded, including overwritten ones
+    TraceEvent events[TRACE_EVENTS]; // Span n is at n % TRACE_EVENTS
+} TraceBuffer;
+
+// Returns the list of every thread's buffer, which lives until the program exits
+inline std::vector<TraceBuffer *> & traceBuffers(std::mutex ** lock)
+{
+    static std::mutex bufferlock;
+    static std::vector<TraceBuffer *> buffers;
+    *lock = &bufferlock;
+    return buffers;
+}
+
+// Returns the calling thread's buffer, creating it on first use
+inline TraceBuffer * traceBuffer()
+{
+    static thread_local TraceBuffer * buffer = nullptr;
+    if(buffer == nullptr)
+    {
+        std::mutex * lock;
+        std::vector<TraceBuffer *> & buffers = traceBuffers(&lock);
+        std::lock_guard<std::mutex> guard(*lock);
+        buffer = new TraceBuffer();
+        buffer->tid = buffers.size() + 1;
+        buffer->count = 0;
+        buffers.push_back(buffer);
+    }
+    return buffer;
+}
+
+// Returns the current time in nanoseconds
+inline int64_t traceNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Records a span from its construction to its destruction
+class TraceSpan
+{
+private:
+    const char * name;
+    int64_t start;
+public:
+    TraceSpan(const char * n)
+    {
+        name = n;
+        start = traceNow();
+    }
+
+    ~TraceSpan()
+    {
+        TraceBuffer * buffer = traceBuffer();
+        TraceEvent & event = buffer->events[buffer->count++ % TRACE_EVENTS];
+        event.name = name;
+        event.start = start;
+        event.duration = traceNow() - start;
+    }
+};
+
+// Writes every thread's spans to path, returns true if successful
+inline bool traceWrite(const char * path)
+{
+    FILE * file = fopen(path, "w");
+    if(file == nullptr)
+    {
+        return false;
+    }
+    std::mutex * lock;
+    std::vector<TraceBuffer *> & buffers = traceBuffers(&lock);
+    std::lock_guard<std::mutex> guard(*lock);
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    for(size_t b = 0; b < buffers.size(); b++)
+    {
+        TraceBuffer * buffer = buffers[b];
+        uint64_t begin = buffer->count > TRACE_EVENTS ? buffer->count - TRACE_EVENTS : 0;
+        for(uint64_t i = begin; i < buffer->count; i++)
+        {
+            TraceEvent & event = buffer->events[i % TRACE_EVENTS];
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", event.name, buffer->tid, event.start / 1000.0, event.duration / 1000.0);
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(tracespan, __LINE__)(name)
+#define TRACE_WRITE(path) traceWrite(path)
+
+#else
+
+#define TRACE_SPAN(name)
+#define TRACE_WRITE(path)
+
+#endif
+
+#endif